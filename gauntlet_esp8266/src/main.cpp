@@ -3,9 +3,11 @@
 #include <WiFiUdp.h>
 
 #include <ESPAsyncTCP.h>
+#include "TurretProtocol.h"
 
 #define HOST "192.168.4.1"
 #define PORT 21
+#define ACK_PORT 4210 // Frames go out from here, so the turret's acks come back to it
 
 //AsyncClient client;
 
@@ -34,21 +36,64 @@ void setup() {
   Serial.print("IP Address: ");
   Serial.println(WiFi.localIP()); // Print the local IP address
 
+  udp.begin(ACK_PORT);
 }
 
 char buffer[100];
+uint8_t frame[TP_FRAME_LEN];
+uint16_t seq = 0;
+
+// Turns the glove's aim/rev/fire/burst lines into binary frames, 0 if it isn't one of those.
+// Trigger and burst frames ask for an ack, aim goes out too often to be worth it.
+uint8_t EncodeFrame(const char *msg){
+  float p, y;
+  int n;
+
+  if(sscanf(msg, "P%fY%f", &p, &y) == 2){
+    return TpEncode(frame, TpAim, seq++, micros(), 0, p, y);
+  }else if(sscanf(msg, "B%d", &n) == 1){
+    return TpEncode(frame, TpBurst, seq++, micros(), TP_FLAG_ACK, 0.0f, 0.0f, n);
+  }else if(!strcmp(msg, "revOn") || !strcmp(msg, "revOff")){
+    return TpEncode(frame, TpRev, seq++, micros(), TP_FLAG_ACK | (msg[4] == 'n' ? TP_FLAG_ON : 0));
+  }else if(!strcmp(msg, "fireOn") || !strcmp(msg, "fireOff")){
+    return TpEncode(frame, TpFire, seq++, micros(), TP_FLAG_ACK | (msg[5] == 'n' ? TP_FLAG_ON : 0));
+  }
+  return 0;
+}
+
+// Trigger to actuation: round trip on our clock, and how much of it the turret spent after receiving
+void PrintAcks(){
+  uint8_t buf[TP_FRAME_LEN];
+
+  while(udp.parsePacket()){
+    const TpAckFrame *ack = TpDecodeAck(buf, udp.read(buf, sizeof(buf)));
+    if(ack){
+      Serial.printf("ack op %u seq %u: round trip %luus turret %luus\n", ack->ackedOpcode, ack->seq,
+                    (unsigned long) (micros() - ack->senderUs), (unsigned long) (ack->actUs - ack->rxUs));
+    }
+  }
+}
 
 
 void loop() {
   // put your main code here, to run repeatedly:
+  PrintAcks();
 
   if (Serial.available()) { // Check if data is available on Serial
     int bytesRead = Serial.readBytes(buffer, sizeof(buffer) - 1); // Read data into buffer
     buffer[bytesRead] = '\0'; // Null-terminate the string
+    while(bytesRead > 0 && (buffer[bytesRead - 1] == '\n' || buffer[bytesRead - 1] == '\r'))
+      buffer[--bytesRead] = '\0';
     Serial.println(buffer); // Print the received data to Serial 
     
-    udp.beginPacket("255.255.255.255", 21);
-    udp.write(buffer);
+    uint8_t len = EncodeFrame(buffer);
+
+    udp.beginPacket("255.255.255.255", TP_PORT);
+    if(len){
+      udp.write(frame, len);
+    }else{
+      udp.write(buffer); // Intents and everything else stay text
+    }
     udp.endPacket();
   }
 }
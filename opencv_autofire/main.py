@@ -1,24 +1,36 @@
 import math
+import os
 import socket
+import sys
 import cv2
 from ultralytics import YOLO
 import torch
 import time
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "protocol"))
+import turret_protocol as tp
+
 # Check GPU availability
 print("CUDA available:", torch.cuda.is_available())
 print("Using device:", torch.cuda.get_device_name(0) if torch.cuda.is_available() else "CPU")
 
 
 UDP_IP = "192.168.4.1"
-UDP_PORT = 21
+UDP_PORT = tp.PORT
 
 YAW_ANGLE = 30
 PITCH_ANGLE = 50
 MAX_MISSED_FRAMES_CLOSE = 20
 MAX_MISSED_FRAMES_VOICELINE = 8
+ACK_EVERY = 30  # Track frames between latency probes
 
 sock = socket.socket(socket.AF_INET,socket.SOCK_DGRAM)
+sock.setblocking(False)  # Only for the acks, sendto never waits on UDP anyway
+enc = tp.Encoder()
+probes = {}  # seq -> ms from grabbing the camera frame to sending, for frames that asked for an ack
+tracked = 0
+host_ms = None  # Average from grabbing the camera frame to sending its track frame
+net_ms = None   # Average one way network time, half of what the acks show
 
 missed_frames = 0
 is_open = False
@@ -43,11 +55,39 @@ last_target_position = (0, 0)
 def lerp(a, b, t):
     return a + (b - a) * t
 
+def average(avg, x):
+    return x if avg is None else avg * 0.9 + x * 0.1
+
+def send_probe(frame_bytes, grab_us):
+    seq = enc.seq - 1  # The encoder already moved on
+    probes[seq] = ((enc.now_us() - grab_us) & 0xFFFFFFFF) / 1000.0
+    sock.sendto(frame_bytes, (UDP_IP, UDP_PORT))
+
+def poll_acks():
+    global net_ms
+    while True:
+        try:
+            data = sock.recv(64)
+        except OSError:  # Nothing waiting, or nothing sent yet
+            return
+        ack = tp.decode_ack(data)
+        if ack is None:
+            continue
+        rtt, turret = enc.latency(ack)
+        detect = probes.pop(ack.seq, 0.0)
+        net_ms = average(net_ms, (rtt - turret) / 2)
+        print(f"latency op {ack.opcode} seq {ack.seq}: detect->send {detect:.1f}ms round trip {rtt:.1f}ms "
+              f"turret {turret:.1f}ms network {rtt - turret:.1f}ms")
+    if len(probes) > 100:  # Never acked (dropped, coalesced or wrong mode)
+        probes.clear()
+
 while True:
     ret, frame = cap.read()
     if not ret:
         print("Failed to grab frame")
         continue
+    grab_us = enc.now_us()
+    poll_acks()
 
     # YOLO inference
     results = model(frame, verbose=False)[0]
@@ -67,10 +107,10 @@ while True:
         missed_frames = 0
         if not is_open:
             is_open = True
-            sock.sendto(bytearray("Aopen".encode()), (UDP_IP, UDP_PORT))
+            sock.sendto(enc.wings(True, autonomous=True), (UDP_IP, UDP_PORT))
             sock.sendto(bytearray("voiceline_found".encode()), (UDP_IP, UDP_PORT))
-            sock.sendto(bytearray("ArevOn".encode()), (UDP_IP, UDP_PORT))
-            sock.sendto(bytearray("AfireOn".encode()), (UDP_IP, UDP_PORT))
+            sock.sendto(enc.rev(True, autonomous=True), (UDP_IP, UDP_PORT))
+            send_probe(enc.fire(True, autonomous=True, ack=True), grab_us)
     else:
         missed_frames += 1
 
@@ -79,8 +119,8 @@ while True:
 
         if missed_frames > MAX_MISSED_FRAMES_CLOSE and is_open:
             is_open = False
-            sock.sendto(bytearray("Aclose".encode()), (UDP_IP, UDP_PORT))
-            sock.sendto(bytearray("ArevOff".encode()), (UDP_IP, UDP_PORT))
+            sock.sendto(enc.wings(False, autonomous=True), (UDP_IP, UDP_PORT))
+            sock.sendto(enc.rev(False, autonomous=True), (UDP_IP, UDP_PORT))
             sock.sendto(bytearray("voiceline_close".encode()), (UDP_IP, UDP_PORT))
 
     lowest_dist_indx = None
@@ -123,8 +163,14 @@ while True:
                 yaw = lerp(YAW_ANGLE, -YAW_ANGLE, relPosX)
                 pitch = lerp(PITCH_ANGLE, -PITCH_ANGLE, relPosY) + 10
 
-                msg = f"AP{pitch:.2f}Y{yaw:.2f}"
-                sock.sendto(msg.encode(), (UDP_IP, UDP_PORT))
+                tracked += 1
+                if tracked % ACK_EVERY == 0:
+                    send_probe(enc.track(pitch, yaw, ack=True), grab_us)
+                    # The turret leads its aim by this plus its own queueing, so it shoots where the target will be
+                    sock.sendto(enc.aim_latency(host_ms + (net_ms or 0.0)), (UDP_IP, UDP_PORT))
+                else:
+                    sock.sendto(enc.track(pitch, yaw), (UDP_IP, UDP_PORT))
+                host_ms = average(host_ms, ((enc.now_us() - grab_us) & 0xFFFFFFFF) / 1000.0)
 
 
             else:
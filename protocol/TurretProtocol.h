@@ -0,0 +1,112 @@
+// Binary UDP control frames for the turret, shared by the turret firmware and everything that talks
+// to it (gauntlet bridge, autofire, tools). turret_protocol.py next to this is the Python copy.
+//
+// One frame per datagram, TP_FRAME_LEN bytes, little endian. The first byte is TP_MAGIC, which no
+// text command starts with, so the turret still takes the old text commands from anything that
+// sends them. Bump TP_VERSION whenever the layout changes, the turret drops other versions.
+#ifndef TURRET_PROTOCOL_H
+#define TURRET_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define TP_MAGIC 0xB7
+#define TP_VERSION 1
+#define TP_PORT 21
+
+enum TpOpcode : uint8_t {
+    TpAim = 1,       // pitchCd/yawCd, manual aim (glove)
+    TpTrack,         // pitchCd/yawCd of a moving target, goes through the aim filter (autofire)
+    TpAimLatency,    // value = ms between seeing the target and sending
+    TpRev,           // TP_FLAG_ON
+    TpFire,          // TP_FLAG_ON
+    TpWings,         // TP_FLAG_ON = open
+    TpBurst,         // value = shots
+    TpVolley,        // value = VolleyPattern | stagger offset ms << 8
+    TP_OPCODES
+};
+
+#define TP_FLAG_ON (1 << 0)
+#define TP_FLAG_AUTONOMOUS (1 << 1) // Only act on it in autonomous mode, like the A-prefixed text commands
+#define TP_FLAG_ACK (1 << 2)        // Send a TpAckFrame back once the turret has acted on it
+
+struct __attribute__((packed)) TpFrame {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t seq;       // Per sender, wraps
+    uint32_t senderUs;  // Sender's own clock, only compared against itself
+    int16_t pitchCd;
+    int16_t yawCd;
+    int32_t value;
+};
+
+#define TP_FRAME_LEN 18
+static_assert(sizeof(TpFrame) == TP_FRAME_LEN, "TpFrame layout changed, bump TP_VERSION");
+
+// Turret -> sender, to the address and port the acked frame came from. Same length and magic as a
+// TpFrame but an opcode outside TpOpcode, so TpDecode() never takes one for a command. rxUs and actUs
+// are on the turret's clock, senderUs is the sender's own, so the sender gets its round trip from
+// senderUs and the turret's share of it from actUs - rxUs. Aim frames replaced by a newer one before
+// they were used, or dropped for the wrong mode or being stale, never get one.
+#define TP_ACK 0x80
+
+struct __attribute__((packed)) TpAckFrame {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t opcode;     // TP_ACK
+    uint8_t ackedOpcode;
+    uint16_t seq;       // Echoed
+    uint32_t senderUs;  // Echoed
+    uint32_t rxUs;      // When the datagram came in
+    uint32_t actUs;     // When it was acted on: the solenoid on edge for fire on, the control task taking it for the rest
+};
+
+static_assert(sizeof(TpAckFrame) == TP_FRAME_LEN, "TpAckFrame layout changed, bump TP_VERSION");
+
+inline int16_t TpCentidegrees(float deg){
+    float cd = deg * 100.0f;
+    if(cd > 32767.0f) cd = 32767.0f;
+    if(cd < -32768.0f) cd = -32768.0f;
+    return (int16_t) (cd < 0.0f ? cd - 0.5f : cd + 0.5f);
+}
+
+// Fills buf (TP_FRAME_LEN bytes) and returns TP_FRAME_LEN
+inline uint8_t TpEncode(uint8_t *buf, TpOpcode op, uint16_t seq, uint32_t senderUs, uint8_t flags = 0,
+                        float pitch = 0.0f, float yaw = 0.0f, int32_t value = 0){
+    TpFrame f;
+    f.magic = TP_MAGIC;
+    f.version = TP_VERSION;
+    f.opcode = op;
+    f.flags = flags;
+    f.seq = seq;
+    f.senderUs = senderUs;
+    f.pitchCd = TpCentidegrees(pitch);
+    f.yawCd = TpCentidegrees(yaw);
+    f.value = value;
+    memcpy(buf, &f, sizeof(f));
+    return TP_FRAME_LEN;
+}
+
+inline bool TpIsFrame(const uint8_t *buf, uint32_t len){
+    return len >= 1 && buf[0] == TP_MAGIC;
+}
+
+// The frame in place, or NULL if it's the wrong size, version or opcode
+inline const TpFrame *TpDecode(const uint8_t *buf, uint32_t len){
+    const TpFrame *f = (const TpFrame *) buf;
+    if(len != TP_FRAME_LEN || f->magic != TP_MAGIC || f->version != TP_VERSION || f->opcode == 0 || f->opcode >= TP_OPCODES)
+        return NULL;
+    return f;
+}
+
+// The ack in place, or NULL if it isn't one
+inline const TpAckFrame *TpDecodeAck(const uint8_t *buf, uint32_t len){
+    const TpAckFrame *a = (const TpAckFrame *) buf;
+    if(len != TP_FRAME_LEN || a->magic != TP_MAGIC || a->version != TP_VERSION || a->opcode != TP_ACK)
+        return NULL;
+    return a;
+}
+
+#endif
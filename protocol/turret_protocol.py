@@ -0,0 +1,93 @@
+"""Python side of TurretProtocol.h, keep the two in step.
+
+    import turret_protocol as tp
+    enc = tp.Encoder()
+    sock.sendto(enc.track(pitch, yaw), (ip, tp.PORT))
+
+Pass ack=True to get an Ack back once the turret has acted on the frame, enc.latency(ack) splits it
+into round trip and time spent in the turret.
+"""
+import collections
+import struct
+import time
+
+MAGIC = 0xB7
+VERSION = 1
+PORT = 21
+
+AIM, TRACK, AIM_LATENCY, REV, FIRE, WINGS, BURST, VOLLEY = range(1, 9)
+
+FLAG_ON = 1 << 0
+FLAG_AUTONOMOUS = 1 << 1
+FLAG_ACK = 1 << 2
+
+ACK = 0x80
+
+FRAME = struct.Struct("<BBBBHIhhi")
+assert FRAME.size == 18
+
+ACK_FRAME = struct.Struct("<BBBBHIII")
+assert ACK_FRAME.size == FRAME.size
+
+Ack = collections.namedtuple("Ack", "opcode seq sender_us rx_us act_us")
+
+
+def centidegrees(deg):
+    return max(-32768, min(32767, int(round(deg * 100))))
+
+
+def decode_ack(data):
+    """The Ack in a datagram from the turret, or None if it isn't one."""
+    if len(data) != ACK_FRAME.size:
+        return None
+    magic, version, op, acked, seq, sender_us, rx_us, act_us = ACK_FRAME.unpack(data)
+    if magic != MAGIC or version != VERSION or op != ACK:
+        return None
+    return Ack(acked, seq, sender_us, rx_us, act_us)
+
+
+class Encoder:
+    """Keeps the sequence number and the sender clock for one sender."""
+
+    def __init__(self):
+        self.seq = 0
+        self.t0 = time.monotonic()
+
+    def now_us(self):
+        return int((time.monotonic() - self.t0) * 1e6) & 0xFFFFFFFF
+
+    def frame(self, op, flags=0, pitch=0.0, yaw=0.0, value=0, ack=False):
+        flags |= FLAG_ACK if ack else 0
+        out = FRAME.pack(MAGIC, VERSION, op, flags, self.seq, self.now_us(), centidegrees(pitch), centidegrees(yaw), value)
+        self.seq = (self.seq + 1) & 0xFFFF
+        return out
+
+    def latency(self, ack):
+        """(round trip, turret receive to actuation) in ms for an Ack to one of this encoder's frames."""
+        rtt = (self.now_us() - ack.sender_us) & 0xFFFFFFFF
+        turret = (ack.act_us - ack.rx_us) & 0xFFFFFFFF
+        return rtt / 1000.0, turret / 1000.0
+
+    def aim(self, pitch, yaw, ack=False):
+        return self.frame(AIM, pitch=pitch, yaw=yaw, ack=ack)
+
+    def track(self, pitch, yaw, ack=False):
+        return self.frame(TRACK, FLAG_AUTONOMOUS, pitch, yaw, ack=ack)
+
+    def aim_latency(self, ms, ack=False):
+        return self.frame(AIM_LATENCY, value=int(ms), ack=ack)
+
+    def rev(self, on, autonomous=False, ack=False):
+        return self.frame(REV, (FLAG_ON if on else 0) | (FLAG_AUTONOMOUS if autonomous else 0), ack=ack)
+
+    def fire(self, on, autonomous=False, ack=False):
+        return self.frame(FIRE, (FLAG_ON if on else 0) | (FLAG_AUTONOMOUS if autonomous else 0), ack=ack)
+
+    def wings(self, open_, autonomous=False, ack=False):
+        return self.frame(WINGS, (FLAG_ON if open_ else 0) | (FLAG_AUTONOMOUS if autonomous else 0), ack=ack)
+
+    def burst(self, shots, ack=False):
+        return self.frame(BURST, value=shots, ack=ack)
+
+    def volley(self, pattern, offset_ms=0, ack=False):
+        return self.frame(VOLLEY, value=pattern | (offset_ms << 8), ack=ack)
@@ -0,0 +1,189 @@
+// Text command parser benchmark, run with: .pio/build/native/program bench [messages]
+// Times the String based parser the turret used to have (kept below as it was) against
+// ParseCommand() on the same mix of messages, both going all the way to SendControl().
+
+#include <Arduino.h>
+#include <chrono>
+#include "Server.h"
+#include "Control.h"
+#include "Audio.h"
+
+extern TurretM turretMode;
+extern FireMode fireMode;
+extern FireRate fireRate;
+extern uint16_t fireDelays[];
+extern uint64_t feedBackMillis;
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct IntentAndSlot {
+    String intent;
+    String slot;
+};
+
+static IntentAndSlot LegacyParseIntent(const String& msg){
+  IntentAndSlot out;
+
+  int16_t intEndIndx = msg.indexOf(">");
+  if(msg.startsWith("<") && intEndIndx > 0 ){
+    out.intent = msg.substring(1, intEndIndx);
+
+    int16_t slotStartIndx = msg.indexOf("{");
+    int16_t slotEndIndx  = msg.indexOf("}");
+
+    if(slotStartIndx > 0 && slotEndIndx > 0){
+      out.slot = msg.substring(slotStartIndx+1, slotEndIndx);
+    }
+  }
+
+  return out;
+}
+
+// The intents that only play audio or touch the LEDs are left out of the mix, the rest is as it was
+static void LegacyParseCommand(const String& msg){
+  IntentAndSlot res = LegacyParseIntent(msg);
+
+  if(res.intent.length()){
+    if(res.intent.startsWith("maintenance")){
+      turretMode = Default;
+      SendControl(CmdAim, 0, 0.0f, 0.0f);
+      if(ctlState.targetWingStates[0] == Closed){
+        SetWings(Open);
+      }else{
+        SetWings(Closed);
+      }
+    }else if(res.intent.startsWith("sing")){
+    }else if(res.intent.startsWith("rateoffire")){
+      if(res.slot.startsWith("slow")){
+        fireRate = Slow;
+      }else if(res.slot.startsWith("medium")){
+        fireRate = Medium;
+      }else if(res.slot.startsWith("fast")){
+        fireRate = Fast;
+      }
+      SendControl(CmdFireDelay, fireDelays[fireRate]);
+    }else if(res.intent.startsWith("safety")){
+      if(res.slot.startsWith("on")){
+        SendControl(CmdSafety, true);
+      }else if(res.slot.startsWith("off")){
+        SendControl(CmdSafety, false);
+      }
+    }else if(res.intent.startsWith("feedback")){
+      feedBackMillis = millis();
+    }else if(res.intent.startsWith("cakeisalie")){
+    }else if(res.intent.startsWith("returnauto")){
+      turretMode = Autonomous;
+      SetWings(Closed);
+      SendControl(CmdFire, false);
+      SendControl(CmdRev, false);
+    }else if(res.intent.startsWith("controlovr")){
+      turretMode = GloveManual;
+      SendControl(CmdFire, false);
+      SendControl(CmdRev, false);
+      SetWings(Open);
+    }else if(res.intent.startsWith("openstatus")){
+      if(res.slot.startsWith("deploy")){
+        SetWings(Open);
+      }else if(res.slot.startsWith("retract")){
+        SetWings(Closed);
+      }
+    }else if(res.intent.startsWith("mode")){
+      if(res.slot.startsWith("auto")){
+        fireMode = Auto;
+      }else if(res.slot.startsWith("single")){
+        fireMode = Single;
+      }else if(res.slot.startsWith("burst")){
+        fireMode = Burst;
+      }
+    }
+
+  }else{
+    if(msg.startsWith("P") && turretMode == GloveManual){
+      String pSubstr = msg.substring(1, msg.indexOf('Y'));
+      String ySubstr = msg.substring(msg.indexOf('Y') + 1);
+      SendControl(CmdAim, 0, pSubstr.toFloat(), ySubstr.toFloat());
+    }else if(msg.startsWith("B")){
+      SendControl(CmdBurst, msg.substring(1).toInt());
+    }else if(msg.startsWith("open")){
+      SetWings(Open);
+    }else if(msg == "close"){
+      SetWings(Closed);
+    }else if(msg.startsWith("Aopen") && turretMode == Autonomous){
+      SetWings(Open);
+    }else if(msg == "Aclose" && turretMode == Autonomous){
+      SetWings(Closed);
+    }else if(msg.startsWith("ArevOn") && turretMode == Autonomous){
+      SendControl(CmdRev, true);
+    }else if(msg.startsWith("ArevOff") && turretMode == Autonomous){
+      SendControl(CmdRev, false);
+    }else if(msg.startsWith("AfireOn") && turretMode == Autonomous){
+      SendControl(CmdFire, true);
+    }else if(msg.startsWith("AfireOff") && turretMode == Autonomous){
+      SendControl(CmdFire, false);
+    }else if(msg.startsWith("stats")){
+    }else if(msg.startsWith("telem")){
+    }else if(msg.startsWith("voiceline_found")){
+    }else if(msg.startsWith("revOn")){
+      SendControl(CmdRev, true);
+    }else if(msg.startsWith("revOff")){
+      SendControl(CmdRev, false);
+    }else if(msg.startsWith("fireOn")){
+      SendControl(CmdFire, true);
+    }else if(msg.startsWith("fireOff")){
+      SendControl(CmdFire, false);
+    }else if(msg.startsWith("AP") && turretMode == Autonomous){
+      String pSubstr = msg.substring(2, msg.indexOf('Y'));
+      String ySubstr = msg.substring(msg.indexOf('Y') + 1);
+      SendControl(CmdTrack, 0, pSubstr.toFloat(), ySubstr.toFloat());
+    }else if(msg.startsWith("AL")){
+      SendControl(CmdAimLatency, msg.substring(2).toInt());
+    }else if(msg.startsWith("volley")){
+      VolleyPattern pattern = msg.charAt(6) == 'S' ? Simultaneous : msg.charAt(6) == 'T' ? Staggered : Alternate;
+      int offsetMs = msg.substring(7).toInt();
+      SendControl(CmdVolley, pattern, offsetMs);
+    }
+  }
+}
+
+// Mostly autofire aim packets, like a real engagement
+static const char *benchMsgs[] = {
+  "AP12.34Y-5.67", "AP12.40Y-5.61", "AP12.47Y-5.55", "AP12.51Y-5.50", "AP12.58Y-5.42", "AP12.66Y-5.37",
+  "ArevOn", "AfireOn", "AL60", "<rateoffire>{fast}", "<safety>{off}", "B5", "volleyT30", "AfireOff", "fireOff",
+  "close", "unknown",
+};
+
+#define BENCH_MSGS (sizeof(benchMsgs) / sizeof(benchMsgs[0]))
+
+template<typename F> static double MessagesPerSec(uint32_t count, F parse){
+  ControlCmd cmd;
+  BenchClock::time_point t0 = BenchClock::now();
+
+  for(uint32_t i = 0; i < count; i++){
+    turretMode = Autonomous;
+    parse(benchMsgs[i % BENCH_MSGS]);
+    while(controlCmds.Pop(cmd)); // Nobody is consuming them here
+  }
+
+  return count / std::chrono::duration<double>(BenchClock::now() - t0).count();
+}
+
+void ParseBench(uint32_t count){
+  uint8_t buff[50];
+
+  // Same entry as ServerLoop, the message starts out in the receive buffer
+  double legacy = MessagesPerSec(count, [&](const char *msg){
+    size_t len = strlen(msg);
+    memcpy(buff, msg, len + 1);
+    LegacyParseCommand(String((char*) buff));
+  });
+
+  double viewed = MessagesPerSec(count, [&](const char *msg){
+    size_t len = strlen(msg);
+    memcpy(buff, msg, len + 1);
+    ParseCommand(std::string_view((char*) buff, len));
+  });
+
+  printf("%u messages\n", count);
+  printf("String parser:  %12.0f msg/s\n", legacy);
+  printf("View + hash:    %12.0f msg/s (%.1fx)\n", viewed, viewed / legacy);
+}
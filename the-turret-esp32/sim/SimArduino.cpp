@@ -0,0 +1,308 @@
+// Implementation of the host-side Arduino/ESP-IDF stand-ins declared in sim/mock.
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <AsyncUDP.h>
+#include <stdarg.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "SimArduino.h"
+#include "driver/pulse_cnt.h"
+#include <esp_timer.h>
+
+static uint64_t nowUs = 0;
+
+SimPins simPins;
+std::deque<std::string> simUdpRx;
+std::vector<std::string> simUdpTx;
+std::string simSerialIn;
+bool simSerialEcho = false;
+uint64_t simSerialBytes = 0;
+BaseType_t simCore = 1;
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+TwoWire Wire1;
+WiFiClass WiFi;
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    bool armed;
+    uint64_t dueUs;
+};
+
+static std::vector<esp_timer*> simTimers;
+
+uint64_t SimNowUs() { return nowUs; }
+
+// Moves time forward, running any esp_timer callbacks that fall due on the way at their exact time
+void SimAdvanceUs(uint64_t us){
+    uint64_t end = nowUs + us;
+
+    for(;;){
+        esp_timer *next = nullptr;
+        for(esp_timer *t : simTimers)
+            if(t->armed && t->dueUs <= end && (!next || t->dueUs < next->dueUs))
+                next = t;
+        if(!next)
+            break;
+
+        if(next->dueUs > nowUs)
+            nowUs = next->dueUs;
+        next->armed = false;
+
+        BaseType_t core = simCore;
+        simCore = 0; // The esp_timer task lives on core 0
+        next->args.callback(next->args.arg);
+        simCore = core;
+    }
+
+    nowUs = end;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out){
+    esp_timer *t = new esp_timer{*args, false, 0};
+    simTimers.push_back(t);
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeoutUs){
+    if(t->armed)
+        return ESP_ERR_INVALID_STATE;
+    t->armed = true;
+    t->dueUs = nowUs + timeoutUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t){
+    if(!t->armed)
+        return ESP_ERR_INVALID_STATE;
+    t->armed = false;
+    return ESP_OK;
+}
+
+uint32_t millis() { return (uint32_t)(nowUs / 1000); }
+uint32_t micros() { return (uint32_t)nowUs; }
+void delay(uint32_t ms) { nowUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { nowUs += us; }
+void yield() {}
+int64_t esp_timer_get_time() { return (int64_t)nowUs; }
+
+uint32_t EspClass::getCycleCount(){
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (uint32_t) (ns * getCpuFreqMHz() / 1000);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { simPins.mode[pin] = mode; }
+int digitalRead(uint8_t pin) { return simPins.level[pin]; }
+void digitalWrite(uint8_t pin, uint8_t val) { simPins.level[pin] = val; }
+uint16_t analogRead(uint8_t pin) { return simPins.level[pin] ? 4095 : 0; }
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode){
+    simPins.isr[pin] = fn;
+    simPins.isrArg[pin] = arg;
+    simPins.isrMode[pin] = mode;
+}
+void detachInterrupt(uint8_t pin) { simPins.isr[pin] = nullptr; }
+uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+struct pcnt_unit_t {
+    int low;
+    int high;
+    int count;
+    bool running;
+};
+
+struct pcnt_chan_t {
+    pcnt_unit_t *unit;
+    int gpio;
+    pcnt_channel_edge_action_t pos;
+    pcnt_channel_edge_action_t neg;
+};
+
+static pcnt_unit_t pcntUnits[8];
+static pcnt_chan_t pcntChans[16];
+static uint8_t pcntUnitCount = 0;
+static uint8_t pcntChanCount = 0;
+
+static void PcntEdge(uint8_t pin, bool rising){
+    for(uint8_t i = 0; i < pcntChanCount; i++){
+        pcnt_chan_t &c = pcntChans[i];
+        if(c.gpio != pin || !c.unit->running)
+            continue;
+
+        pcnt_channel_edge_action_t act = rising ? c.pos : c.neg;
+        if(act == PCNT_CHANNEL_EDGE_ACTION_INCREASE && ++c.unit->count >= c.unit->high)
+            c.unit->count = 0;
+        else if(act == PCNT_CHANNEL_EDGE_ACTION_DECREASE && --c.unit->count <= c.unit->low)
+            c.unit->count = 0;
+    }
+}
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config, pcnt_unit_handle_t *ret_unit){
+    if(pcntUnitCount >= 8 || config->low_limit >= 0 || config->high_limit <= 0)
+        return ESP_FAIL;
+    pcntUnits[pcntUnitCount] = {config->low_limit, config->high_limit, 0, false};
+    *ret_unit = &pcntUnits[pcntUnitCount++];
+    return ESP_OK;
+}
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t, const pcnt_glitch_filter_config_t *config){
+    return config->max_glitch_ns <= 12787 ? ESP_OK : ESP_FAIL; // 1023 APB cycles
+}
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *config, pcnt_channel_handle_t *ret_chan){
+    if(pcntChanCount >= 16)
+        return ESP_FAIL;
+    pcntChans[pcntChanCount] = {unit, config->edge_gpio_num, PCNT_CHANNEL_EDGE_ACTION_HOLD, PCNT_CHANNEL_EDGE_ACTION_HOLD};
+    *ret_chan = &pcntChans[pcntChanCount++];
+    return ESP_OK;
+}
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan, pcnt_channel_edge_action_t pos_act, pcnt_channel_edge_action_t neg_act){
+    chan->pos = pos_act;
+    chan->neg = neg_act;
+    return ESP_OK;
+}
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t) { return ESP_OK; }
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) { unit->count = 0; return ESP_OK; }
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) { unit->running = true; return ESP_OK; }
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value) { *value = unit->count; return ESP_OK; }
+
+void SimSetPin(uint8_t pin, bool level){
+    bool old = simPins.level[pin];
+    simPins.level[pin] = level;
+    if(old == level)
+        return;
+
+    PcntEdge(pin, level);
+
+    if(!simPins.isr[pin])
+        return;
+
+    int mode = simPins.isrMode[pin];
+    if(mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level))
+        simPins.isr[pin](simPins.isrArg[pin]);
+}
+
+struct hw_timer_s { uint32_t freq; };
+static hw_timer_s simTimer;
+hw_timer_t* timerBegin(uint32_t frequency) { simTimer.freq = frequency; return &simTimer; }
+void timerAttachInterrupt(hw_timer_t*, void (*)(void)) {}
+void timerAlarm(hw_timer_t*, uint64_t, bool, uint64_t) {}
+
+static uint32_t rngState = 1;
+void randomSeed(unsigned long seed) { rngState = seed ? seed : 1; }
+long random(long max) { rngState = rngState * 1103515245u + 12345u; return max > 0 ? (long)((rngState >> 8) % max) : 0; }
+long random(long min, long max) { return min + random(max - min); }
+
+int HardwareSerial::available() { return simSerialIn.size(); }
+int HardwareSerial::read(){
+    if(simSerialIn.empty())
+        return -1;
+    char c = simSerialIn[0];
+    simSerialIn.erase(0, 1);
+    return c;
+}
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+size_t HardwareSerial::write(const uint8_t* buf, size_t len){
+    simSerialBytes += len;
+    if(simSerialEcho)
+        fwrite(buf, 1, len, stdout);
+    return len;
+}
+size_t HardwareSerial::print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+size_t HardwareSerial::printf(const char* fmt, ...){
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return write((const uint8_t*)buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+static std::string udpCur;
+static size_t udpCurPos = 0;
+int WiFiUDP::parsePacket(){
+    if(simUdpRx.empty())
+        return 0;
+    udpCur = simUdpRx.front();
+    simUdpRx.pop_front();
+    udpCurPos = 0;
+    return udpCur.size();
+}
+int WiFiUDP::read(uint8_t* buf, size_t len){
+    size_t n = std::min(len, udpCur.size() - udpCurPos);
+    memcpy(buf, udpCur.data() + udpCurPos, n);
+    udpCurPos += n;
+    return n;
+}
+size_t WiFiUDP::write(const uint8_t* buf, size_t len){
+    size_t n = std::min(len, sizeof(txBuf) - txLen);
+    memcpy(txBuf + txLen, buf, n);
+    txLen += n;
+    return n;
+}
+int WiFiUDP::endPacket(){
+    simUdpTx.emplace_back((const char*)txBuf, txLen);
+    txLen = 0;
+    return 1;
+}
+
+static AsyncUDP* simAsyncUdp = NULL;
+bool AsyncUDP::listen(uint16_t port){
+    this->port = port;
+    simAsyncUdp = this;
+    return true;
+}
+size_t AsyncUDP::writeTo(const uint8_t* data, size_t len, const IPAddress& addr, uint16_t port){
+    (void)addr; (void)port;
+    simUdpTx.emplace_back((const char*)data, len);
+    return len;
+}
+void SimUdpDeliver(){
+    BaseType_t core = simCore;
+    simCore = 0; // lwIP's task
+    while(simAsyncUdp && simAsyncUdp->handler && !simUdpRx.empty()){
+        std::string msg = simUdpRx.front();
+        simUdpRx.pop_front();
+        AsyncUDPPacket packet((const uint8_t*)msg.data(), msg.size());
+        simAsyncUdp->handler(packet);
+    }
+    simCore = core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle, BaseType_t){
+    static int dummy;
+    if(handle)
+        *handle = &dummy;
+    return pdPASS;
+}
+TaskHandle_t xTaskGetCurrentTaskHandle() { static int self; return &self; }
+void vTaskDelay(TickType_t ticks) { nowUs += (uint64_t)ticks * 1000; }
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks) { *previousWake += ticks; }
+TickType_t xTaskGetTickCount() { return (TickType_t)(nowUs / 1000); }
+void vTaskDelete(TaskHandle_t) {}
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) { if(woken) *woken = pdFALSE; }
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 1; }
+
+// There's only one task anyone notifies (the control task), so one set of bits is enough
+uint32_t simNotifyBits = 0;
+BaseType_t xTaskNotify(TaskHandle_t, uint32_t value, eNotifyAction action){
+    if(action == eSetBits)
+        simNotifyBits |= value;
+    return pdPASS;
+}
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken){
+    if(woken)
+        *woken = pdFALSE;
+    return xTaskNotify(task, value, action);
+}
+BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t* value, TickType_t){
+    if(value)
+        *value = simNotifyBits;
+    simNotifyBits = 0;
+    return pdTRUE;
+}
+BaseType_t xPortGetCoreID() { return simCore; }
@@ -0,0 +1,29 @@
+// Hooks into the host-side Arduino stand-ins, used by the simulator's plant model and scenarios.
+#ifndef SIM_SIMARDUINO_H
+#define SIM_SIMARDUINO_H
+
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct SimPins {
+    uint8_t mode[64] = {};
+    bool level[64] = {};
+    void (*isr[64])(void*) = {};
+    void* isrArg[64] = {};
+    int isrMode[64] = {};
+};
+
+extern SimPins simPins;
+extern std::deque<std::string> simUdpRx;
+extern std::vector<std::string> simUdpTx;
+extern std::string simSerialIn;
+extern bool simSerialEcho;
+extern uint64_t simSerialBytes;
+extern BaseType_t simCore;        // What xPortGetCoreID() says, the simulator sets it around each task body
+extern uint32_t simNotifyBits;    // Pending task notification bits for the control task
+
+void SimSetPin(uint8_t pin, bool level);
+
+#endif
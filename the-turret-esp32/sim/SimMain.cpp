@@ -0,0 +1,713 @@
+// Native simulation of the turret firmware. The real WingsAndFiring.cpp/Server.cpp/AuxFuncs.cpp are
+// built against the stand-ins in sim/mock, time only moves when we say so, and a small plant model
+// closes the loop (wing travel and endstops, feeder paddles, flywheel current).
+//
+//   pio run -e native && .pio/build/native/program [iterations]
+//
+// Runs the open/rev/burst/auto/jam/close scenario over and over, checks it behaved, and reports
+// how much host CPU each control loop costs per call. "program bench [messages]" runs the text
+// command parser benchmark in ParseBench.cpp instead.
+
+#include <Arduino.h>
+#include <chrono>
+#include "SimArduino.h"
+#include "PinsAndDefs.h"
+#include "AimFilter.h"
+#include "AuxFuncs.h"
+#include "Scheduler.h"
+#include "Control.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "Endstops.h"
+#include "FireEngine.h"
+#include "RevDetect.h"
+#include "PowerSampler.h"
+#include "JamDetect.h"
+#include "MotorStart.h"
+#include "ServoCal.h"
+#include "Server.h"
+#include "Latency.h"
+#include "WingArray.h"
+
+extern SchedTask schedTasks[];
+extern uint8_t schedTaskCount;
+
+extern uint8_t expServoIndxs[];
+extern uint8_t closedSWPins[];
+extern uint8_t openSWPins[];
+extern uint8_t feederSensePins[];
+extern uint8_t fireSolenoidPins[];
+extern uint8_t revIndxs[];
+extern INA226 currSens[];
+extern uint32_t paddleTotal[];
+extern FireEngineStats fireStats[];
+extern RevDetector revDetect[];
+extern JamDetector jamDetect[];
+extern ServoLut servoLuts[];
+extern uint32_t tpBadFrames;
+extern uint32_t aimCoalesced;
+extern uint32_t latencyFireTimeouts;
+extern MotorStarter motors[];
+extern ProfSection profSections[];
+extern TurretM turretMode;
+extern WingArray<WINGS> wings;
+extern AimFilter aimFilter;
+extern float yawMaxVel[];
+extern float yawMaxAcc[];
+
+void setup();
+void ControlWake(uint32_t bits);
+void AppLoop();
+void ParseBench(uint32_t count);
+
+#define SIM_SUBSTEPS 5 // Plant steps per scheduler tick, so interrupts can land between ticks
+#define SIM_FIRE_PULSE_TOL_US 50
+#define SIM_WING_TRAVEL_PER_S 1.4f // Fraction of full open/close travel per second at full servo speed
+#define SIM_WING_HARD_STOP -0.1f   // How far past the closed switch the wing can physically go
+#define SIM_PADDLE_HZ_MAX 25.0f    // Paddle pulses per second at full feeder duty
+#define SIM_PADDLE_HIGH_US 4000
+#define SIM_PADDLE_BOUNCE_US 2000  // The sensor contact chatters this long after the rising edge
+#define SIM_PADDLE_CHATTER_US 300
+#define SIM_FLYWHEEL_TAU_S 0.35f
+#define SIM_FEED_PATH_BBS 3
+#define SIM_BB_FLYWHEEL_LOSS 0.1f
+#define SIM_REV_NOLOAD_MA 400.0f
+#define SIM_REV_STALL_MA 9000.0f
+#define SIM_FEED_MAX_DUTY_S 8.0f // Feeder duty-seconds per scenario run, a flat 0.7 while revving took ~11.8
+#define SIM_FEED_MAX_PADDLES_PER_SHOT 2.2f // ~3.4 at a flat 0.7
+#define SIM_FEED_MIN_FED 0.9f // Fraction of shots that had a BB, so the savings aren't from starving it
+#define SIM_START_US ((1ULL << 32) - 2000000) // micros() wraps 2s into the run, like after 71.6 minutes up
+
+typedef std::chrono::steady_clock HostClock;
+
+struct LoopCost {
+    const char *name;
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t maxNs;
+};
+
+LoopCost costs[SCHED_MAX_TASKS + 2] = {};
+void (*origFns[SCHED_MAX_TASKS])() = {};
+
+static void Account(LoopCost &c, HostClock::time_point t0){
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(HostClock::now() - t0).count();
+    c.calls++;
+    c.totalNs += ns;
+    if(ns > c.maxNs)
+        c.maxNs = ns;
+}
+
+template<int I> void TimedTask(){
+    HostClock::time_point t0 = HostClock::now();
+    origFns[I]();
+    Account(costs[I], t0);
+}
+
+template<int I> void WrapTask(){
+    if(I < schedTaskCount){
+        origFns[I] = schedTasks[I].fn;
+        schedTasks[I].fn = &TimedTask<I>;
+        costs[I].name = schedTasks[I].name;
+    }
+    if constexpr (I + 1 < SCHED_MAX_TASKS)
+        WrapTask<I + 1>();
+}
+
+// Plant model
+
+struct Plant {
+    float wingPos[WINGS];      // 0 closed, 1 open
+    float wingMinPos[WINGS];   // Deepest it went past the closed switch
+    float feedPhase[WINGS];
+    uint64_t paddleHighUntil[WINGS];
+    bool jammed[WINGS];        // Feeder stuck, paddles stop
+    bool clumped[WINGS];       // Paddles turn but no BB makes it to the chamber
+    uint8_t loaded[WINGS];     // BBs in the feed path in front of the solenoid
+    float flywheel[WINGS];     // 0..1 of full speed
+    bool lastSol[WINGS];
+    uint32_t shots[WINGS];
+    uint32_t fedShots[WINGS];
+    float feederOnS;           // Feeder motor duty integrated over time
+    float peakRevMA;           // Both flywheels together
+    uint64_t revOnUs[WINGS];   // When the flywheel last got any duty, 0 while off
+    uint32_t paddles[WINGS];
+};
+
+Plant plant = {};
+
+// What the chip actually has, not the shadow
+static uint16_t SimPWM(uint8_t addr){
+    return pwmBoards[PWM_BOARD(addr)].getChannelPWM(PWM_CHANNEL(addr));
+}
+
+static float ServoSpeed(uint16_t reg){
+    if(reg == 0) // No pulse, servo is limp
+        return 0.0f;
+
+    float mid = (pwmServo.minPWM + pwmServo.maxPWM) / 2.0f;
+    return (reg - mid) / ((pwmServo.maxPWM - pwmServo.minPWM) / 2.0f);
+}
+
+static void PlantStep(float dt){
+    float revMA = 0.0f;
+    for(uint8_t i = 0; i < WINGS; i++){
+        // Wings, negative servo speed opens
+        float s = ServoSpeed(SimPWM(expServoIndxs[i]));
+        plant.wingPos[i] = constrain(plant.wingPos[i] - s * SIM_WING_TRAVEL_PER_S * dt, SIM_WING_HARD_STOP, 1.0f);
+        plant.wingMinPos[i] = min(plant.wingMinPos[i], plant.wingPos[i]);
+
+        SimSetPin(closedSWPins[i], plant.wingPos[i] <= 0.0f);
+        SimSetPin(openSWPins[i], plant.wingPos[i] < 0.98f); // Open switch pulls low
+
+        // Feeder paddles
+        float duty = SimPWM(FEEDER_MOTOR_INDX) / 4096.0f;
+        if(i == 0)
+            plant.feederOnS += duty * dt;
+        if(!plant.jammed[i])
+            plant.feedPhase[i] += duty * SIM_PADDLE_HZ_MAX * dt;
+
+        if(plant.feedPhase[i] >= 1.0f){
+            plant.feedPhase[i] -= 1.0f;
+            plant.paddleHighUntil[i] = SimNowUs() + SIM_PADDLE_HIGH_US;
+            plant.paddles[i]++;
+            if(!plant.clumped[i] && plant.loaded[i] < SIM_FEED_PATH_BBS)
+                plant.loaded[i]++;
+        }
+        bool paddleHigh = SimNowUs() < plant.paddleHighUntil[i];
+        if(paddleHigh && SimNowUs() < plant.paddleHighUntil[i] - SIM_PADDLE_HIGH_US + SIM_PADDLE_BOUNCE_US)
+            paddleHigh = (SimNowUs() / SIM_PADDLE_CHATTER_US) & 1;
+        SimSetPin(feederSensePins[i], paddleHigh);
+
+        // Flywheel, first order spin up, current is mostly back-EMF deficit
+        float rev = SimPWM(revIndxs[i]) / 4096.0f;
+        if(rev > 0.0f && !plant.revOnUs[i])
+            plant.revOnUs[i] = SimNowUs();
+        else if(rev == 0.0f)
+            plant.revOnUs[i] = 0;
+        plant.flywheel[i] += (rev - plant.flywheel[i]) * dt / SIM_FLYWHEEL_TAU_S;
+        currSens[i].current_mA = rev > 0.0f ? SIM_REV_NOLOAD_MA * plant.flywheel[i] + SIM_REV_STALL_MA * max(0.0f, rev - plant.flywheel[i]) : 0.0f;
+        currSens[i].busV = 12.4f - currSens[i].current_mA / 1000.0f * 0.08f;
+        revMA += currSens[i].current_mA;
+
+        // Solenoid shots
+        bool sol = simPins.level[fireSolenoidPins[i]];
+        if(sol && !plant.lastSol[i]){
+            plant.shots[i]++;
+            if(plant.loaded[i]){ // The BB loads the flywheel on its way through
+                plant.loaded[i]--;
+                plant.flywheel[i] *= 1.0f - SIM_BB_FLYWHEEL_LOSS;
+                plant.fedShots[i]++;
+            }
+        }
+        plant.lastSol[i] = sol;
+    }
+    plant.peakRevMA = max(plant.peakRevMA, revMA);
+}
+
+// Stepping
+
+uint64_t appDueUs = 0;
+uint64_t telemDueUs = 0;
+uint64_t powerDueUs = 0;
+
+static void Step(){
+    simCore = CONTROL_CORE;
+
+    for(uint8_t i = 0; i < SIM_SUBSTEPS; i++){
+        SimAdvanceUs(SCHED_TICK_US / SIM_SUBSTEPS);
+        PlantStep(SCHED_TICK_US / SIM_SUBSTEPS / 1000000.0f);
+
+        if(simNotifyBits && i < SIM_SUBSTEPS - 1){ // Something other than the timer woke the control task
+            uint32_t bits = simNotifyBits;
+            simNotifyBits = 0;
+            ControlWake(bits);
+        }
+    }
+
+    HostClock::time_point t0 = HostClock::now();
+    uint32_t bits = simNotifyBits | SCHED_NOTIFY_TICK;
+    simNotifyBits = 0;
+    ControlWake(bits);
+    Account(costs[SCHED_MAX_TASKS], t0);
+
+    SimUdpDeliver(); // lwIP hands datagrams over whenever they arrive
+
+    simCore = APP_CORE;
+    if(SimNowUs() >= appDueUs){ // AppTask runs every FreeRTOS tick
+        t0 = HostClock::now();
+        AppLoop();
+        Account(costs[SCHED_MAX_TASKS + 1], t0);
+        appDueUs = SimNowUs() + 1000;
+    }
+
+    if(SimNowUs() >= powerDueUs){
+        PowerSample();
+        powerDueUs = SimNowUs() + 1000000 / POWER_SAMPLE_HZ;
+    }
+
+    if(SimNowUs() >= telemDueUs){
+        TelemetryDrain();
+        telemDueUs = SimNowUs() + 5000;
+    }
+}
+
+static void RunFor(uint32_t ms){
+    uint64_t end = SimNowUs() + (uint64_t) ms * 1000;
+    while(SimNowUs() < end)
+        Step();
+}
+
+template<typename F> static bool RunUntil(F done, uint32_t timeoutMs){
+    uint64_t end = SimNowUs() + (uint64_t) timeoutMs * 1000;
+    while(SimNowUs() < end){
+        Step();
+        if(done())
+            return true;
+    }
+    return false;
+}
+
+static void Send(const char *msg){
+    simUdpRx.push_back(msg);
+}
+
+// Binary frame, same as the gauntlet bridge and autofire send
+static void SendFrame(TpOpcode op, uint8_t flags = 0, int32_t value = 0, uint8_t version = TP_VERSION){
+    static uint16_t seq = 0;
+    uint8_t buf[TP_FRAME_LEN];
+    TpEncode(buf, op, seq++, (uint32_t) SimNowUs(), flags, 0.0f, 0.0f, value);
+    buf[1] = version;
+    simUdpRx.push_back(std::string((char *) buf, sizeof(buf)));
+}
+
+// Newest ack for op sent back since simUdpTx was last cleared
+static const TpAckFrame *FindAck(TpOpcode op){
+    for(auto it = simUdpTx.rbegin(); it != simUdpTx.rend(); ++it){
+        const TpAckFrame *ack = TpDecodeAck((const uint8_t *) it->data(), it->size());
+        if(ack && ack->ackedOpcode == op)
+            return ack;
+    }
+    return NULL;
+}
+
+static uint32_t TotalShots(){
+    uint32_t n = 0;
+    for(uint8_t i = 0; i < WINGS; i++)
+        n += plant.shots[i];
+    return n;
+}
+
+static bool AllWings(WingState s){
+    for(uint8_t i = 0; i < WINGS; i++)
+        if(ctlState.wingStates[i] != s)
+            return false;
+    return true;
+}
+
+// Scenario
+
+uint32_t failures = 0;
+
+static void Check(bool ok, const char *what){
+    if(!ok){
+        failures++;
+        printf("FAIL @%llums: %s\n", (unsigned long long) (SimNowUs() / 1000), what);
+    }
+}
+
+static void Scenario(){
+    Send("open");
+    Check(RunUntil([]{ return AllWings(Open); }, 3000), "wings did not open");
+
+    Send("revOn");
+    Check(RunUntil([]{ return RevReady(0) && RevReady(1); }, FIRE_REV_MS + 200), "flywheels never came up to speed");
+    for(uint8_t i = 0; i < WINGS; i++){
+        Check(revDetect[i].spinUpMs > 0, "spin up fell back to FIRE_REV_MS");
+        Check(plant.flywheel[i] >= 0.9f * FIRE_REV_IDLE_COEF, "flywheel called ready well short of speed");
+    }
+    Check(plant.revOnUs[0] && plant.revOnUs[1] &&
+          llabs((int64_t) (plant.revOnUs[0] - plant.revOnUs[1])) >= MOTOR_STAGGER_MS * 1000LL, "flywheels started together");
+    Check(plant.peakRevMA < MOTOR_CURRENT_BUDGET_MA, "flywheel starts went over the current budget");
+
+    uint32_t jams[WINGS], clumps[WINGS];
+    for(uint8_t i = 0; i < WINGS; i++){
+        jams[i] = jamDetect[i].jams;
+        clumps[i] = jamDetect[i].clumps;
+    }
+
+    uint32_t before = TotalShots();
+    SendFrame(TpBurst, TP_FLAG_ACK, 5);
+    RunFor(1000);
+    Check(TotalShots() - before == 5, "burst of 5 did not fire 5 shots");
+    const TpAckFrame *ack = FindAck(TpBurst);
+    Check(ack && ack->actUs - ack->rxUs <= SCHED_TICK_US + 1000, "no ack for the burst frame, or a late one");
+
+    before = TotalShots();
+    FireEngineResetStats();
+    Send("fireOn");
+    RunFor(2000);
+    Send("fireOff");
+    RunFor(200);
+    uint32_t alternateShots = TotalShots() - before;
+    Check(alternateShots > 10, "full auto barely fired");
+    for(uint8_t i = 0; i < WINGS; i++){
+        Check(abs(fireStats[i].maxPulseErrUs) <= SIM_FIRE_PULSE_TOL_US, "solenoid pulse width off");
+        Check(fireStats[i].maxPeriodUs <= WINGS * (FIRE_ON_MS + FIRE_OFF_MS + fireDelayMs) * 1000UL + SIM_FIRE_PULSE_TOL_US,
+              "full auto slower than its fire rate");
+    }
+
+
+    // Both wings on their own cycle should double the rate
+    const char *patterns[] = {"volleyS", "volleyT", "volleyT30"};
+    for(const char *p : patterns){
+        Send(p);
+        before = TotalShots();
+        uint32_t fireAcks = latencyHists[LatFire].n;
+        SendFrame(TpFire, TP_FLAG_ON | TP_FLAG_ACK);
+        RunFor(2000);
+        ack = FindAck(TpFire);
+        Check(latencyHists[LatFire].n == fireAcks + 1 && ack && (int32_t) (ack->actUs - ack->rxUs) > 0 &&
+              ack->actUs - ack->rxUs <= (FIRE_ON_MS + FIRE_OFF_MS + fireDelayMs) * 1000UL, "fire on not acked at its solenoid edge");
+        SendFrame(TpFire, 0);
+        RunFor(200);
+        Check(TotalShots() - before >= alternateShots * 2 - WINGS, "volley pattern didn't double the rate");
+        for(uint8_t i = 0; i < WINGS; i++)
+            Check(fireStats[i].periodUs <= (FIRE_ON_MS + FIRE_OFF_MS + fireDelayMs) * 1000UL + SIM_FIRE_PULSE_TOL_US,
+                  "wing not firing on its own cycle");
+    }
+    Send("volleyA");
+
+    for(uint8_t i = 0; i < WINGS; i++)
+        Check(jamDetect[i].jams == jams[i] && jamDetect[i].clumps == clumps[i], "jam/clump detected while feeding fine");
+
+    // Feeder jams on one wing, it should be caught and the other wing keep firing
+    plant.jammed[0] = true;
+    before = plant.shots[1];
+    Send("fireOn");
+    Check(RunUntil([]{ return wings.feedStates[0] == Jam; }, 3000), "jam not detected");
+    Check(jamDetect[1].jams == jams[1] && jamDetect[1].clumps == clumps[1], "jam detected on the wing that was fine");
+
+    // The shared feeder stays stopped for the whole back phase, whatever the other wing is doing
+    bool feederStopped = true;
+    RunUntil([&]{ feederStopped &= SimPWM(FEEDER_MOTOR_INDX) == 0; return false; }, JAM_CLEAR_BACK_MS - 5);
+    Check(feederStopped, "feeder kept running through the jam back phase");
+    Check(RunUntil([]{ return SimPWM(FEEDER_MOTOR_INDX) > 0; }, 100), "feeder didn't push through after backing off");
+    plant.jammed[0] = false;
+
+    RunFor(1000);
+    Check(plant.shots[1] - before > 5, "other wing stopped firing during the jam");
+    Send("fireOff");
+    Check(RunUntil([]{ return ctlState.feedStates[0] == Nominal; }, 3000), "wing didn't recover from the jam");
+
+    // BBs clumped up in front of one wing
+    plant.clumped[1] = true;
+    plant.loaded[1] = 0;
+    Send("fireOn");
+    Check(RunUntil([]{ return ctlState.feedStates[1] == Clump; }, 3000), "clump not detected");
+    Check(jamDetect[1].jams == jams[1], "clump taken for a jam");
+    plant.clumped[1] = false;
+    Send("fireOff");
+    Check(RunUntil([]{ return ctlState.feedStates[1] == Nominal; }, 3000), "wing didn't recover from the clump");
+    RunFor(200);
+
+    uint32_t bad = tpBadFrames;
+    SendFrame(TpRev, 0, 0, TP_VERSION + 1); // Nobody should act on a version it doesn't know
+    RunFor(50);
+    Check(tpBadFrames == bad + 1 && RevReady(0), "frame with the wrong version wasn't dropped");
+
+    Send("revOff");
+    for(uint8_t i = 0; i < WINGS; i++)
+        plant.wingMinPos[i] = 0.0f;
+    Send("close");
+    Check(RunUntil([]{ return AllWings(Closed); }, 4000), "wings did not close");
+    RunFor(500);
+    for(uint8_t i = 0; i < WINGS; i++) // The slow bit past the switch, timed from the endstop interrupt
+        Check(-plant.wingMinPos[i] > 0.5f * CLOSE_EXTRA_SPEED * SIM_WING_TRAVEL_PER_S * CLOSE_EXTRA_TIME_MS / 1000.0f,
+              "wing stopped at the closed switch without the extra close travel");
+
+    size_t replies = simUdpTx.size();
+    Send("stats");
+    RunFor(10);
+    Check(simUdpTx.size() == replies + 1, "no reply to stats query");
+    Check(simUdpTx.back().find('\0') == std::string::npos && simUdpTx.back().find("lat fire") != std::string::npos,
+          "stats reply cut short or carries its terminator");
+    simUdpTx.clear();
+}
+
+// The lookup tables against the float mapping they start from, then a jog/save/reload round trip
+static void ServoCalCheck(){
+    int maxErr = 0;
+    for(int cd = SERVO_CAL_MIN_CD; cd <= SERVO_CAL_MAX_CD; cd += 50)
+        maxErr = max(maxErr, abs((int) ServoCalPWM(SERVO_YAW(1), cd) - (int) pwmServo.pwmForAngle(cd / 100.0f)));
+    Check(maxErr <= 1, "servo table is off the linear mapping");
+
+    uint16_t knot = servoLuts[SERVO_PITCH(0)].pwm[SERVO_CAL_POINTS / 2];
+    ServoCalCommand(CalNextServo, 0);
+    ServoCalCommand(CalJog, 20);
+    ServoCalCommand(CalSave, 0);
+    Check(ServoCalHolds(SERVO_PITCH(0)), "servo being calibrated isn't held");
+
+    servoLuts[SERVO_PITCH(0)].pwm[SERVO_CAL_POINTS / 2] = 0;
+    InitServoCal();
+    Check(servoLuts[SERVO_PITCH(0)].pwm[SERVO_CAL_POINTS / 2] == knot + 20, "servo table didn't come back from NVS");
+    Check(ServoCalPWM(SERVO_PITCH(0), SERVO_CAL_STEP_CD / 2) == (knot + 20 + servoLuts[SERVO_PITCH(0)].pwm[SERVO_CAL_POINTS / 2 + 1] + 1) / 2,
+          "servo table doesn't interpolate");
+
+    ServoCalCommand(CalDefault, 0);
+    ServoCalCommand(CalSave, 0);
+    for(uint8_t i = 0; i < AIM_SERVOS; i++)
+        ServoCalCommand(CalNextServo, 0);
+    Check(!ServoCalHolds(SERVO_PITCH(0)) && servoLuts[SERVO_PITCH(0)].pwm[SERVO_CAL_POINTS / 2] == knot, "servo cal didn't end");
+}
+
+// A burst of aim packets in one pass goes out as the newest one, commands in between keep their place
+static void ServerDrainCheck(){
+    TurretM mode = turretMode;
+    turretMode = Autonomous;
+
+    uint32_t coalesced = aimCoalesced;
+    for(int i = 0; i < 10; i++)
+        Send(("AP" + std::to_string(i) + "Y0").c_str());
+    Send("AfireOn");
+    for(int i = 10; i < 15; i++)
+        Send(("AP" + std::to_string(i) + "Y0").c_str());
+    SimUdpDeliver();
+    ServerLoop();
+
+    ControlCmd cmds[4];
+    uint8_t n = 0;
+    while(n < 4 && controlCmds.Pop(cmds[n]))
+        n++;
+    Check(n == 3 && cmds[0].type == CmdTrack && cmds[0].a == 9.0f && cmds[1].type == CmdFire &&
+          cmds[2].type == CmdTrack && cmds[2].a == 14.0f, "aim packets weren't coalesced in order");
+    Check(aimCoalesced - coalesced == 13, "coalesced aim count off");
+
+    turretMode = mode;
+}
+
+// A target crossing at a constant rate should be aimed ahead of by the lead the turret reports, then
+// a manual step should follow the yaw profile's limits and stop on the target without overshooting
+static void AimCheck(){
+    TurretM mode = turretMode;
+    Send("open");
+    RunUntil([]{ return AllWings(Open); }, 3000);
+
+    turretMode = Autonomous;
+    Send("AL40");
+    const float vel = 10.0f; // deg/s
+    uint32_t t0 = millis();
+    for(int i = 0; i < 45; i++){ // 1.5s of a 30fps camera
+        Send(("AP0Y" + std::to_string(-10.0f + vel * (millis() - t0) / 1000.0f)).c_str());
+        RunFor(33);
+    }
+    float target = -10.0f + vel * (ctlState.timeMs - t0) / 1000.0f;
+    float leadMs = (ctlState.yaw - target) / vel * 1000.0f;
+    Check(ctlState.tracking && ctlState.aimLeadMs >= 40.0f && fabsf(leadMs - ctlState.aimLeadMs) < 10.0f,
+          "tracked aim doesn't lead the target by the aim latency");
+
+    // Timed from when the datagram came in, not from when the app task got round to it
+    Send("AP0Y0");
+    SimUdpDeliver();
+    uint32_t rxUs = micros();
+    SimAdvanceUs(3000);
+    RunFor(5);
+    Check(aimFilter.lastUs == rxUs, "aim filter timed the packet from after the drain");
+
+    turretMode = GloveManual;
+    Send("P0Y20");
+    AxisProfile &ax = wings.yawProfiles[0];
+    float lastVel = ax.vel, maxVel = 0.0f, maxDv = 0.0f, maxPos = ax.pos;
+    RunUntil([&]{
+        maxVel = max(maxVel, fabsf(ax.vel));
+        if(ax.vel != 0.0f) // Landing on the target zeroes it in one go
+            maxDv = max(maxDv, fabsf(ax.vel - lastVel));
+        maxPos = max(maxPos, ax.pos);
+        lastVel = ax.vel;
+        return false;
+    }, 300);
+    Check(maxVel <= yawMaxVel[0] && maxDv <= yawMaxAcc[0] / WING_LOOP_HZ * 1.001f, "yaw profile went past its limits");
+    Check(ax.pos == 20.0f && maxPos <= 20.0f, "yaw profile overshot or didn't reach the step");
+
+    turretMode = mode;
+}
+
+// A write goes out in its own board's burst and lands on that board only. Board b writes the channel
+// at the end next to board b + 1's, where an off by one in the board/channel split would bleed across.
+static void PwmBoardsCheck(){
+    uint16_t regs[PWM_BOARDS][PWM_BOARD_CHANNELS];
+    uint32_t bursts[PWM_BOARDS];
+    uint8_t addrs[PWM_BOARDS];
+    for(uint8_t b = 0; b < PWM_BOARDS; b++){
+        Check(b == 0 || pwmBoards[b].addr != pwmBoards[b - 1].addr, "two PWM boards on one i2c address");
+        memcpy(regs[b], pwmBoards[b].regs, sizeof(regs[b]));
+        bursts[b] = pwmBoards[b].transactions;
+        addrs[b] = PWM_ADDR(b, b % 2 ? 0 : PWM_BOARD_CHANNELS - 1);
+        WritePWMRaw(addrs[b], SimPWM(addrs[b]) == 1234 ? 1235 : 1234);
+    }
+    FlushPWM();
+
+    for(uint8_t b = 0; b < PWM_BOARDS; b++){
+        Check(pwmBoards[b].transactions - bursts[b] == 1, "PWM board didn't get exactly one burst");
+        for(uint8_t ch = 0; ch < PWM_BOARD_CHANNELS; ch++)
+            if((pwmBoards[b].regs[ch] != regs[b][ch]) != (PWM_ADDR(b, ch) == addrs[b]))
+                Check(false, "PWM write landed on the wrong board or channel");
+        WritePWMRaw(addrs[b], regs[b][PWM_CHANNEL(addrs[b])]);
+    }
+    FlushPWM();
+
+    // The power task reads these on the app core, they can't hold the bus the flush needs
+    for(uint8_t i = 0; i < WINGS; i++)
+        Check(currSens[i].wire != &Wire, "current sensor on the PWM boards' bus");
+
+    // What the wings drive ends up on their head's board
+    Check(SimPWM(YAW_SERVO_INDEX_L) && (HEAD_BOARD_L == HEAD_BOARD_R || !pwmBoards[HEAD_BOARD_R].regs[PWM_CHANNEL(YAW_SERVO_INDEX_L)]),
+          "left head isn't driven on its own board");
+}
+
+// Run before any wing has fired and while micros() is in its top half: a fire on with the wings closed
+// has to time out, not match a wing whose last on edge is still 0. 'C' only clears the histograms
+// once the control task gets to it.
+static void LatencyCheck(){
+    SendFrame(TpFire, TP_FLAG_ON | TP_FLAG_ACK);
+    RunFor(LAT_FIRE_TIMEOUT_MS + 100);
+    SendFrame(TpFire, 0);
+    RunFor(10);
+    Check(latencyHists[LatFire].n == 0 && latencyFireTimeouts == 1, "fire on with the wings closed matched a shot");
+
+    uint32_t n = latencyHists[LatCommand].n;
+    LatencyResetStats();
+    Check(n && latencyHists[LatCommand].n == n, "latency stats reset off the control task");
+    RunFor(1);
+    Check(!latencyHists[LatCommand].n && !latencyFireTimeouts, "latency stats weren't reset");
+}
+
+// 'C' on the app core only asks, each owner clears its own stats on its next pass
+static void StatsResetCheck(){
+    uint32_t runs = schedTasks[0].runs;
+    SchedulerResetStats();
+    Check(runs && schedTasks[0].runs == runs, "scheduler stats reset off the control task");
+
+    RunFor(1);
+    for(uint8_t i = 0; i < schedTaskCount; i++)
+        Check(schedTasks[i].runs <= 1000 / schedTasks[i].periodUs + 1, "scheduler stats weren't reset");
+
+    fireStats[0].shots = 1; // Nothing has fired yet
+    FireEngineResetStats();
+    Check(fireStats[0].shots == 1, "fire stats reset off the control task");
+    RunFor(1);
+    Check(!fireStats[0].shots, "fire stats weren't reset");
+
+    motors[MOTOR_FEEDER].starts = 1;
+    MotorStartResetStats();
+    Check(motors[MOTOR_FEEDER].starts == 1, "motor start stats reset off the control task");
+    RunFor(1000 / MOTOR_START_HZ + 1);
+    Check(!motors[MOTOR_FEEDER].starts, "motor start stats weren't reset");
+
+    uint32_t ticks = profSections[ProfTick].count;
+    ProfReset();
+    Check(ticks && profSections[ProfTick].count == ticks, "profiler reset off the core timing the section");
+    RunFor(1);
+    Check(profSections[ProfTick].count <= 1000 / SCHED_TICK_US + 1, "profiler wasn't reset");
+}
+
+// Every control loop keeps running once micros() has wrapped
+static void MicrosWrapCheck(){
+    RunUntil([]{ return SimNowUs() >= (1ULL << 32); }, 3000);
+
+    uint32_t runs[SCHED_MAX_TASKS];
+    for(uint8_t i = 0; i < schedTaskCount; i++)
+        runs[i] = schedTasks[i].runs;
+    RunFor(100);
+
+    for(uint8_t i = 0; i < schedTaskCount; i++)
+        Check(schedTasks[i].runs - runs[i] >= 100000 / schedTasks[i].periodUs - 1, "control loop stopped when micros() wrapped");
+}
+
+int main(int argc, char **argv){
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 100;
+
+    SimSetPin(closedSWPins[0], true);
+    SimSetPin(closedSWPins[1], true);
+    SimSetPin(openSWPins[0], true);
+    SimSetPin(openSWPins[1], true);
+    for(uint8_t i = 0; i < WINGS; i++)
+        plant.wingMinPos[i] = 0.0f;
+
+    SimAdvanceUs(SIM_START_US);
+    simCore = APP_CORE;
+    setup();
+    simCore = CONTROL_CORE; // What ControlTask does before its loop
+    InitScheduler();
+    InitEndstops();
+
+    if(argc > 1 && !strcmp(argv[1], "bench")){
+        ParseBench(argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+
+    WrapTask<0>();
+    costs[SCHED_MAX_TASKS].name = "tick";
+    costs[SCHED_MAX_TASKS + 1].name = "app";
+
+    ServoCalCheck();
+    ServerDrainCheck();
+    LatencyCheck();
+    StatsResetCheck();
+    MicrosWrapCheck();
+    AimCheck();
+    PwmBoardsCheck();
+
+    HostClock::time_point start = HostClock::now();
+    uint64_t simStart = SimNowUs();
+
+    for(uint32_t n = 0; n < iterations; n++)
+        Scenario();
+
+    RunFor(10);
+    for(uint8_t i = 0; i < WINGS; i++)
+        Check(paddleTotal[i] == plant.paddles[i], "paddle count doesn't match the plant");
+
+    uint32_t fed = 0;
+    for(uint8_t i = 0; i < WINGS; i++)
+        fed += plant.fedShots[i];
+    Check(plant.feederOnS / max(iterations, 1u) < SIM_FEED_MAX_DUTY_S, "feeder ran more than the fire rate needs");
+    Check((plant.paddles[0] + plant.paddles[1]) / (float) TotalShots() < SIM_FEED_MAX_PADDLES_PER_SHOT, "too many paddles per shot");
+    Check(fed >= SIM_FEED_MIN_FED * TotalShots(), "feeder left too many shots without a BB");
+
+    double hostS = std::chrono::duration<double>(HostClock::now() - start).count();
+    double simS = (SimNowUs() - simStart) / 1000000.0;
+
+    printf("%u scenario runs, %.1fs simulated in %.3fs host (%.0fx real time)\n", iterations, simS, hostS, simS / hostS);
+    printf("shots R: %u (%u fed) L: %u (%u fed) paddles R: %u L: %u\n", plant.shots[0], plant.fedShots[0], plant.shots[1],
+           plant.fedShots[1], plant.paddles[0], plant.paddles[1]);
+    printf("telemetry %.0fB/s\n", simSerialBytes / simS);
+    printf("feeder %.1f duty-s, %.2f paddles per shot\n", plant.feederOnS,
+           (plant.paddles[0] + plant.paddles[1]) / (float) TotalShots());
+    printf("peak flywheel current %.0fmA (budget %.0fmA)\n", plant.peakRevMA, MOTOR_CURRENT_BUDGET_MA);
+    printf("flywheel spin up R: %ums L: %ums (fallback %ums)\n", revDetect[0].spinUpMs, revDetect[1].spinUpMs, FIRE_REV_MS);
+    printf("closed switch overtravel R: %.3f L: %.3f\n", -plant.wingMinPos[0], -plant.wingMinPos[1]);
+
+    printf("%-8s %10s %10s %10s\n", "loop", "calls", "avg ns", "max ns");
+    for(uint8_t i = 0; i < SCHED_MAX_TASKS + 2; i++){
+        LoopCost &c = costs[i];
+        if(!c.name || !c.calls)
+            continue;
+        printf("%-8s %10llu %10llu %10llu\n", c.name, (unsigned long long) c.calls,
+               (unsigned long long) (c.totalNs / c.calls), (unsigned long long) c.maxNs);
+    }
+
+    simSerialEcho = true;
+    SchedulerPrintStats();
+    PrintPWMStats();
+    FireEnginePrintStats();
+    PowerPrintStats();
+    JamDetectPrintStats();
+    MotorStartPrintStats();
+    ServerPrintStats();
+    LatencyPrintStats();
+    ProfPrint();
+
+    printf("%s (%u failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
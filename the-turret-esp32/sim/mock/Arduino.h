@@ -0,0 +1,177 @@
+// Host-side stand-in for the Arduino-ESP32 core, just enough to build the turret firmware natively.
+// Time is virtual: it only moves when the simulator calls SimAdvanceUs().
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Virtual clock and pin model, implemented in sim/SimArduino.cpp
+uint64_t SimNowUs();
+void SimAdvanceUs(uint64_t us);
+
+// 32 bits like on the ESP32 (unsigned long is 64 here), so the sim wraps where the turret does
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+uint16_t analogRead(uint8_t pin);
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+uint8_t digitalPinToInterrupt(uint8_t pin);
+
+struct hw_timer_s;
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t* timerBegin(uint32_t frequency);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void));
+void timerAlarm(hw_timer_t* timer, uint64_t alarm, bool autoreload, uint64_t reloadCount);
+
+void randomSeed(unsigned long seed);
+long random(long max);
+long random(long min, long max);
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(long long v) : s_(std::to_string(v)) {}
+    String(unsigned long long v) : s_(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { Fmt(v, decimals); }
+    String(double v, unsigned int decimals = 2) { Fmt(v, decimals); }
+
+    unsigned int length() const { return s_.size(); }
+    const char* c_str() const { return s_.c_str(); }
+
+    char charAt(unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    bool endsWith(const String& p) const { return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0; }
+
+    int indexOf(char c) const { size_t i = s_.find(c); return i == std::string::npos ? -1 : (int)i; }
+    int indexOf(const char* c) const { size_t i = s_.find(c); return i == std::string::npos ? -1 : (int)i; }
+
+    String substring(unsigned int from) const { return from >= s_.size() ? String() : String(s_.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+        if(from > to) std::swap(from, to);
+        if(from >= s_.size()) return String();
+        return String(s_.substr(from, std::min<size_t>(to, s_.size()) - from));
+    }
+
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* o) const { return s_ == o; }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+    friend String operator+(const char* a, const String& b) { return String(std::string(a) + b.s_); }
+    friend String operator+(const String& a, const char* b) { return String(a.s_ + b); }
+
+private:
+    void Fmt(double v, unsigned int decimals){
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        s_ = buf;
+    }
+    std::string s_;
+};
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr_{a, b, c, d} {}
+    uint8_t operator[](int i) const { return addr_[i]; }
+    bool operator==(const IPAddress& o) const { return memcmp(addr_, o.addr_, 4) == 0; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr_[0], addr_[1], addr_[2], addr_[3]);
+        return String(buf);
+    }
+private:
+    uint8_t addr_[4] = {};
+};
+
+// Cycle counter runs off the host clock so profiler numbers mean real CPU time
+class EspClass {
+public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeHeap() { return 200000; }
+};
+
+extern EspClass ESP;
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void setTimeout(unsigned long) {}
+    int available();
+    int read();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+    int availableForWrite() { return 128; }
+    void flush() {}
+
+    size_t print(const String& s);
+    size_t print(const char* s) { return print(String(s)); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int d = 2) { return print(String(v, d)); }
+    size_t print(const IPAddress& ip) { return print(ip.toString()); }
+
+    size_t println() { return print("\n"); }
+    template<typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t println(double v, int d) { size_t n = print(v, d); return n + println(); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+#endif
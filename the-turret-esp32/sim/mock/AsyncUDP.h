@@ -0,0 +1,37 @@
+// Host-side AsyncUDP stand-in: the simulator hands queued datagrams to the onPacket handler with
+// SimUdpDeliver(), as if lwIP had received them, and collects replies.
+#ifndef SIM_ASYNCUDP_H
+#define SIM_ASYNCUDP_H
+
+#include <Arduino.h>
+#include <functional>
+
+class AsyncUDPPacket {
+public:
+    AsyncUDPPacket(const uint8_t* data, size_t len) : _data(data), _len(len) {}
+
+    const uint8_t* data() { return _data; }
+    size_t length() { return _len; }
+    IPAddress remoteIP() { return IPAddress(192, 168, 4, 2); }
+    uint16_t remotePort() { return 4210; }
+
+private:
+    const uint8_t* _data;
+    size_t _len;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+public:
+    bool listen(uint16_t port);
+    void onPacket(AuPacketHandlerFunction cb) { handler = cb; }
+    size_t writeTo(const uint8_t* data, size_t len, const IPAddress& addr, uint16_t port);
+
+    uint16_t port = 0;
+    AuPacketHandlerFunction handler;
+};
+
+void SimUdpDeliver(); // Everything in simUdpRx, on the network "task"
+
+#endif
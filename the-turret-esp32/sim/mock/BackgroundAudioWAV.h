@@ -0,0 +1,16 @@
+#ifndef SIM_BACKGROUNDAUDIOWAV_H
+#define SIM_BACKGROUNDAUDIOWAV_H
+
+#include <Arduino.h>
+#include "ESP32I2SAudio.h"
+
+class ROMBackgroundAudioWAV {
+public:
+    ROMBackgroundAudioWAV(ESP32I2SAudio& out) { (void)out; }
+    bool begin() { return true; }
+    void setGain(float) {}
+    void flush() {}
+    size_t write(const void*, size_t len) { return len; }
+};
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef SIM_ESP32I2SAUDIO_H
+#define SIM_ESP32I2SAUDIO_H
+
+#include <Arduino.h>
+
+class ESP32I2SAudio {
+public:
+    ESP32I2SAudio(int8_t bclk, int8_t lrclk, int8_t dout, int8_t mclk = -1) { (void)bclk; (void)lrclk; (void)dout; (void)mclk; }
+};
+
+#endif
@@ -0,0 +1,33 @@
+// Host-side INA226 stand-in; the simulator's plant model feeds it current and voltage.
+#ifndef SIM_INA226_H
+#define SIM_INA226_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define INA226_4_SAMPLES 1
+#define INA226_588_us 3
+
+class INA226 {
+public:
+    INA226(uint8_t address, TwoWire* wire = &Wire) : address(address), wire(wire) {}
+
+    bool begin() { return true; }
+    int setMaxCurrentShunt(float, float, bool = true) { return 0; }
+    bool setAverage(uint8_t) { return true; }
+    bool setBusVoltageConversionTime(uint8_t) { return true; }
+    bool setShuntVoltageConversionTime(uint8_t) { return true; }
+    bool setModeShuntBusContinuous() { return true; }
+
+    float getBusVoltage() { return busV; }
+    float getShuntVoltage() { return current_mA * 0.01f / 1000.0f; }
+    float getCurrent_mA() { return current_mA; }
+    float getPower_mW() { return busV * current_mA; }
+
+    uint8_t address;
+    TwoWire* wire;
+    float busV = 12.0f;
+    float current_mA = 0.0f;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SIM_NEOPIXELBUS_H
+#define SIM_NEOPIXELBUS_H
+
+#include <Arduino.h>
+
+struct RgbColor {
+    RgbColor(uint8_t r = 0, uint8_t g = 0, uint8_t b = 0) : R(r), G(g), B(b) {}
+    uint8_t R, G, B;
+};
+
+class NeoGrbFeature {};
+class NeoWs2812xMethod {};
+class NeoGammaTableMethod {};
+
+template<typename T_FEATURE, typename T_METHOD> class NeoPixelBus {
+public:
+    NeoPixelBus(uint16_t count, uint8_t pin) : count(count) { (void)pin; }
+    void Begin() {}
+    void Show() { shows++; }
+    void ClearTo(RgbColor c) { ClearTo(c, 0, count - 1); }
+    void ClearTo(RgbColor c, uint16_t first, uint16_t last) { for(uint16_t i = first; i <= last && i < 64; i++) px[i] = c; }
+    void SetPixelColor(uint16_t i, RgbColor c) { if(i < 64) px[i] = c; }
+
+    uint16_t count;
+    RgbColor px[64];
+    uint32_t shows = 0;
+};
+
+template<typename T_METHOD> class NeoGamma {
+public:
+    RgbColor Correct(const RgbColor& c) { return c; }
+};
+
+#endif
@@ -0,0 +1,59 @@
+// Host-side PCA9685 stand-in: keeps the 16 channel registers and counts bus traffic.
+#ifndef SIM_PCA9685_H
+#define SIM_PCA9685_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class PCA9685 {
+public:
+    PCA9685(TwoWire& wire, uint32_t speed = 400000, uint8_t addr = 0x00) : addr(addr) { (void)wire; (void)speed; }
+    PCA9685(uint8_t addr = 0x00, TwoWire& wire = Wire, uint32_t speed = 400000) : addr(addr) { (void)wire; (void)speed; }
+
+    void resetDevices() {}
+    void init() {}
+    void setPWMFrequency(float) {}
+    void setPWMFreqServo() {}
+
+    void setChannelPWM(int channel, uint16_t pwmAmount){
+        regs[channel] = pwmAmount;
+        transactions++;
+        bytes += 6;
+    }
+    void setChannelsPWM(int begChannel, int numChannels, const uint16_t* pwmAmounts){
+        for(int i = 0; i < numChannels; i++)
+            regs[begChannel + i] = pwmAmounts[i];
+        transactions++;
+        bytes += 2 + 4 * numChannels;
+    }
+    void setAllChannelsPWM(uint16_t pwmAmount){
+        for(int i = 0; i < 16; i++)
+            regs[i] = pwmAmount;
+        transactions++;
+        bytes += 6;
+    }
+    uint16_t getChannelPWM(int channel) { return regs[channel]; }
+
+    uint8_t addr;
+    uint16_t regs[16] = {};
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+};
+
+class PCA9685_ServoEval {
+public:
+    PCA9685_ServoEval(uint16_t minPWMAmount = 102, uint16_t maxPWMAmount = 512)
+        : minPWM(minPWMAmount), maxPWM(maxPWMAmount) {}
+
+    uint16_t pwmForAngle(float angle){
+        angle = constrain(angle, -90.0f, 90.0f);
+        return (uint16_t)lroundf(minPWM + (maxPWM - minPWM) * (angle + 90.0f) / 180.0f);
+    }
+    uint16_t pwmForSpeed(float speed){
+        return pwmForAngle(constrain(speed, -1.0f, 1.0f) * 90.0f);
+    }
+
+    uint16_t minPWM, maxPWM;
+};
+
+#endif
@@ -0,0 +1,40 @@
+// Host-side Preferences stand-in: namespaces of byte blobs kept in memory for the life of the process.
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) { (void)readOnly; ns = name; return true; }
+    void end() {}
+
+    size_t putBytes(const char* key, const void* value, size_t len){
+        const uint8_t* p = (const uint8_t*)value;
+        Store()[ns + "/" + key].assign(p, p + len);
+        return len;
+    }
+    size_t getBytesLength(const char* key){
+        auto it = Store().find(ns + "/" + key);
+        return it == Store().end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char* key, void* buf, size_t maxLen){
+        auto it = Store().find(ns + "/" + key);
+        if(it == Store().end() || it->second.size() > maxLen)
+            return 0;
+        memcpy(buf, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    static std::map<std::string, std::vector<uint8_t>>& Store(){
+        static std::map<std::string, std::vector<uint8_t>> store;
+        return store;
+    }
+
+    std::string ns;
+};
+
+#endif
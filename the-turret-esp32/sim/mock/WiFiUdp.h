@@ -0,0 +1,27 @@
+// Host-side WiFiUDP stand-in: the simulator queues inbound datagrams and collects replies.
+#ifndef SIM_WIFIUDP_H
+#define SIM_WIFIUDP_H
+
+#include <Arduino.h>
+
+class WiFiUDP {
+public:
+    uint8_t begin(uint16_t port) { this->port = port; return 1; }
+    int parsePacket();
+    int read(uint8_t* buf, size_t len);
+    int read(char* buf, size_t len) { return read((uint8_t*)buf, len); }
+    IPAddress remoteIP() { return IPAddress(192, 168, 4, 2); }
+    uint16_t remotePort() { return 4210; }
+
+    int beginPacket(IPAddress ip, uint16_t port) { (void)ip; (void)port; txLen = 0; return 1; }
+    int beginPacket(const char* host, uint16_t port) { (void)host; (void)port; txLen = 0; return 1; }
+    size_t write(const uint8_t* buf, size_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    int endPacket();
+
+    uint16_t port = 0;
+    uint8_t txBuf[512];
+    size_t txLen = 0;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    void begin() {}
+    void begin(int sda, int scl) { (void)sda; (void)scl; }
+    void setClock(uint32_t) {}
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
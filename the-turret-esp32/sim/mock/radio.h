@@ -0,0 +1,2 @@
+const unsigned char radio_wav[] = {0};
+unsigned int radio_wav_len = 0;
@@ -0,0 +1,49 @@
+#include "AimFilter.h"
+#include "PinsAndDefs.h"
+
+static void UpdateAxis(AimAxis &ax, float meas, float dt){
+    float predicted = ax.pos + ax.vel * dt;
+    float residual = meas - predicted;
+
+    ax.pos = predicted + AIM_FILTER_ALPHA * residual;
+    ax.vel += AIM_FILTER_BETA * residual / dt;
+    ax.vel = constrain(ax.vel, -AIM_MAX_TARGET_VEL, AIM_MAX_TARGET_VEL);
+}
+
+void AimFilterReset(AimFilter &f, float pitch, float yaw, uint32_t nowUs){
+    f.pitch = {pitch, 0.0f};
+    f.yaw = {yaw, 0.0f};
+    f.lastUs = nowUs;
+    f.valid = true;
+}
+
+void AimFilterUpdate(AimFilter &f, float pitch, float yaw, uint32_t rxUs){
+    float dt = (rxUs - f.lastUs) / 1000000.0f;
+
+    // Lost the target for a while or it jumped to someone else, start over from this sample
+    if(!f.valid || dt * 1000.0f > AIM_FILTER_TIMEOUT_MS || fabsf(pitch - f.pitch.pos) > AIM_FILTER_RESET_DEG ||
+       fabsf(yaw - f.yaw.pos) > AIM_FILTER_RESET_DEG){
+        AimFilterReset(f, pitch, yaw, rxUs);
+        return;
+    }
+
+    if(dt < 0.001f) // Two packets in the same ms, the velocity term would blow up
+        dt = 0.001f;
+
+    UpdateAxis(f.pitch, pitch, dt);
+    UpdateAxis(f.yaw, yaw, dt);
+
+    f.lastUs = rxUs;
+}
+
+void AimFilterPredict(const AimFilter &f, uint32_t nowUs, float leadMs, float &pitch, float &yaw){
+    if(!f.valid)
+        return;
+
+    // Don't keep flying off along the last velocity if packets stop coming
+    float ahead = (nowUs - f.lastUs) / 1000.0f + leadMs;
+    ahead = constrain(ahead, 0.0f, (float) AIM_MAX_EXTRAPOLATE_MS) / 1000.0f;
+
+    pitch = f.pitch.pos + f.pitch.vel * ahead;
+    yaw = f.yaw.pos + f.yaw.vel * ahead;
+}
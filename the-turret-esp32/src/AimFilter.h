@@ -0,0 +1,26 @@
+#ifndef AIM_FILTER_H
+#define AIM_FILTER_H
+
+#include <Arduino.h>
+
+// Alpha-beta tracker for the autonomous aim point. AP packets only come in at the camera frame
+// rate, so between packets we extrapolate the target's angular position from its estimated
+// velocity, and lead it by the latency between the frame being taken and the servos moving.
+
+struct AimAxis {
+    float pos; // deg
+    float vel; // deg/s
+};
+
+struct AimFilter {
+    AimAxis pitch;
+    AimAxis yaw;
+    uint32_t lastUs;   // When the last measurement arrived
+    bool valid;
+};
+
+void AimFilterReset(AimFilter &f, float pitch, float yaw, uint32_t nowUs);
+void AimFilterUpdate(AimFilter &f, float pitch, float yaw, uint32_t rxUs);
+void AimFilterPredict(const AimFilter &f, uint32_t nowUs, float leadMs, float &pitch, float &yaw);
+
+#endif
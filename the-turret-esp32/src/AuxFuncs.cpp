@@ -1,9 +1,11 @@
 #include "AuxFuncs.h"
 #include "PinsAndDefs.h"
+#include "Control.h"
+#include "ServoCal.h"
+#include "driver/pulse_cnt.h"
 
 
 
-extern INA226 currSens[];
 extern NeoPixelBus<NeoGrbFeature, NeoWs2812xMethod> leds;
 extern NeoGamma<NeoGammaTableMethod> gammaCorr;
 
@@ -16,28 +18,53 @@ extern RgbColor feedBackColors[];
 extern TurretM turretMode;
 extern FireMode fireMode;
 extern FireRate fireRate;
-extern bool safety;
 
 extern uint64_t feedBackMillis;
 
-void InitPWM(){
-    Wire.begin();
+// Shadow copy of every PCA9685's channel registers. The Write* functions below only touch the shadow,
+// FlushPWM() then sends whatever changed, one auto-increment burst per board that has changes, at the
+// end of the control tick. Only the control task may call these.
 
-    pwm.resetDevices();       // Resets all PCA9685 devices on i2c line
+#define PWM_SINGLE_WRITE_BYTES 6 // Address, register, 4 data bytes
+#define PWM_BURST_OVERHEAD_BYTES 2
 
-    pwm.init();               // Initializes module using default totem-pole driver mode, and default disabled phase balancer
-    pwm.setPWMFreqServo();    // 50Hz provides standard 20ms servo phase length
+uint16_t pwmShadow[PWM_BOARDS][PWM_BOARD_CHANNELS] = {};
+uint16_t pwmSent[PWM_BOARDS][PWM_BOARD_CHANNELS] = {};
+uint16_t pwmDirty[PWM_BOARDS] = {};
 
+uint32_t pwmRequestedBytes = 0; // What the writes would have cost one transaction at a time
+uint32_t pwmSentBytes = 0;
+uint32_t pwmBursts[PWM_BOARDS] = {};
+uint32_t pwmSavedBytesPerSec = 0;
 
+// Feeder paddles are counted by the PCNT peripheral, one unit per wing, so no edge gets missed
+// however long a loop pass takes. The hardware counter wraps at PADDLE_PCNT_LIMIT, ReadPaddleCount()
+// folds that into a running total. The glitch filter only catches us spikes, the sensor's contact
+// bounce is ms long, so ReadPaddleCount() also drops counts closer than PADDLE_MIN_INTERVAL_MS.
 
-    if(!currSens[0].begin())
-        Serial.println("Failed to init right current sensor");
-    
-    if(!currSens[1].begin())
-        Serial.println("Failed to init left current sensor");
+#define PADDLE_PCNT_LIMIT 10000
+
+pcnt_unit_handle_t paddleUnits[WINGS] = {};
+int paddleLastRaw[WINGS] = {};
+uint32_t paddleTotal[WINGS] = {};
+uint32_t paddleCountedMs[WINGS] = {}; // Last read that counted any
+uint32_t paddleReadMs[WINGS] = {};
+uint32_t paddleBounces[WINGS] = {};
+
+void InitPWM(){
+    Wire.begin();
+
+    pwmBoards[0].resetDevices();       // Resets all PCA9685 devices on i2c line
+
+    for(uint8_t b = 0; b < PWM_BOARDS; b++){
+        pwmBoards[b].init();               // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+        pwmBoards[b].setPWMFreqServo();    // 50Hz provides standard 20ms servo phase length
+        pwmBoards[b].setAllChannelsPWM(0); // Known state so the shadow matches the chip
+    }
 
-    currSens[0].setMaxCurrentShunt(1, 0.01);
-    currSens[1].setMaxCurrentShunt(1, 0.01);
+    memset(pwmShadow, 0, sizeof(pwmShadow));
+    memset(pwmSent, 0, sizeof(pwmSent));
+    memset(pwmDirty, 0, sizeof(pwmDirty));
 }
 
 
@@ -52,6 +79,65 @@ void InitPins(){
         pinMode(openSWPins[i], INPUT_PULLUP);
     }
     randomSeed(analogRead(35));
+
+    InitPaddleCounters();
+}
+
+void InitPaddleCounters(){
+    pcnt_unit_config_t unitConfig = {};
+    unitConfig.low_limit = -1; // Has to straddle 0, we only ever count up
+    unitConfig.high_limit = PADDLE_PCNT_LIMIT;
+
+    pcnt_glitch_filter_config_t filterConfig = {};
+    filterConfig.max_glitch_ns = PADDLE_GLITCH_FILTER_NS;
+
+    for(uint8_t i = 0; i < WINGS; i++){
+        pcnt_chan_config_t chanConfig = {};
+        chanConfig.edge_gpio_num = feederSensePins[i];
+        chanConfig.level_gpio_num = -1;
+
+        pcnt_channel_handle_t chan = NULL;
+        if(pcnt_new_unit(&unitConfig, &paddleUnits[i]) != ESP_OK ||
+           pcnt_unit_set_glitch_filter(paddleUnits[i], &filterConfig) != ESP_OK ||
+           pcnt_new_channel(paddleUnits[i], &chanConfig, &chan) != ESP_OK){
+            Serial.println("Failed to init paddle counter " + String(i));
+            paddleUnits[i] = NULL;
+            continue;
+        }
+
+        pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD); // Rising edges only
+        pcnt_unit_enable(paddleUnits[i]);
+        pcnt_unit_clear_count(paddleUnits[i]);
+        pcnt_unit_start(paddleUnits[i]);
+    }
+}
+
+uint32_t ReadPaddleCount(uint8_t wing){
+    if(!paddleUnits[wing])
+        return 0;
+
+    int raw = 0;
+    pcnt_unit_get_count(paddleUnits[wing], &raw);
+
+    int delta = raw - paddleLastRaw[wing];
+    if(delta < 0) // Wrapped at PADDLE_PCNT_LIMIT since the last read
+        delta += PADDLE_PCNT_LIMIT;
+
+    // At most one paddle per interval since the last one counted, and since the last read, so a
+    // bounce after a long quiet spell still counts once
+    uint32_t now = millis();
+    int most = min((now - paddleCountedMs[wing]) / PADDLE_MIN_INTERVAL_MS, 1 + (now - paddleReadMs[wing]) / PADDLE_MIN_INTERVAL_MS);
+    paddleReadMs[wing] = now;
+    if(delta > most){
+        paddleBounces[wing] += delta - most;
+        delta = most;
+    }
+    if(delta)
+        paddleCountedMs[wing] = now;
+
+    paddleLastRaw[wing] = raw;
+    paddleTotal[wing] += delta;
+    return paddleTotal[wing];
 }
 
 void InitNeopixel(){
@@ -59,17 +145,102 @@ void InitNeopixel(){
     leds.Show();
 }
 
-void WriteServo(uint8_t indx, float pos){
-    pwm.setChannelPWM(indx, pwmServo.pwmForAngle(pos));
+void WriteServo(uint8_t servo, int16_t cd){
+    if(ServoCalHolds(servo))
+        return;
+    WritePWMRaw(ServoPWMIndx(servo), ServoCalPWM(servo, cd));
 }
 
 void WriteServoSpeed(uint8_t indx, float s){
-    pwm.setChannelPWM(indx, pwmServo.pwmForSpeed(s));
+    WritePWMRaw(indx, pwmServo.pwmForSpeed(s));
 }
 
 void WritePWMDuty(uint8_t indx, float val){
     uint16_t v = constrain(val * 4096, 0, 4096);
-    pwm.setChannelPWM(indx, v);
+    WritePWMRaw(indx, v);
+}
+
+void WritePWMRaw(uint8_t indx, uint16_t val){
+    uint8_t b = PWM_BOARD(indx);
+    uint8_t ch = PWM_CHANNEL(indx);
+
+    pwmRequestedBytes += PWM_SINGLE_WRITE_BYTES;
+    pwmShadow[b][ch] = val;
+
+    if(val == pwmSent[b][ch])
+        pwmDirty[b] &= ~(1 << ch); // Back to what the chip already has
+    else
+        pwmDirty[b] |= (1 << ch);
+}
+
+static void FlushPWMBoard(uint8_t b){
+    uint16_t dirty = pwmDirty[b];
+    uint16_t *shadow = pwmShadow[b];
+
+    uint8_t first = __builtin_ctz(dirty);
+    uint8_t last = 15 - __builtin_clz((uint32_t) dirty << 16);
+
+    // One burst over the whole span rewrites the clean channels in between, separate bursts per run
+    // pay the addressing again. Go with whichever is fewer bytes on the bus.
+    uint8_t runs = 0;
+    for(uint8_t i = first; i <= last; i++)
+        if((dirty & (1 << i)) && (i == first || !(dirty & (1 << (i - 1)))))
+            runs++;
+
+    uint16_t spanBytes = PWM_BURST_OVERHEAD_BYTES + 4 * (last - first + 1);
+    uint16_t runBytes = runs * PWM_BURST_OVERHEAD_BYTES + 4 * __builtin_popcount(dirty);
+
+    if(spanBytes <= runBytes){
+        pwmBoards[b].setChannelsPWM(first, last - first + 1, &shadow[first]);
+        pwmSentBytes += spanBytes;
+        pwmBursts[b]++;
+    }else{
+        uint8_t i = first;
+        while(i <= last){
+            if(!(dirty & (1 << i))){
+                i++;
+                continue;
+            }
+
+            uint8_t beg = i;
+            while(i <= last && (dirty & (1 << i)))
+                i++;
+
+            pwmBoards[b].setChannelsPWM(beg, i - beg, &shadow[beg]);
+            pwmSentBytes += PWM_BURST_OVERHEAD_BYTES + 4 * (i - beg);
+            pwmBursts[b]++;
+        }
+    }
+
+    memcpy(pwmSent[b], shadow, sizeof(pwmSent[b]));
+    pwmDirty[b] = 0;
+}
+
+void FlushPWM(){
+    static uint32_t statMillis = 0;
+    static uint32_t statSaved = 0;
+    if(millis() - statMillis >= 1000){
+        uint32_t saved = pwmRequestedBytes - pwmSentBytes;
+        pwmSavedBytesPerSec = saved - statSaved;
+        statSaved = saved;
+        statMillis = millis();
+    }
+
+    for(uint8_t b = 0; b < PWM_BOARDS; b++)
+        if(pwmDirty[b])
+            FlushPWMBoard(b);
+}
+
+void PrintPWMStats(){
+    uint32_t bursts = 0;
+    for(uint8_t b = 0; b < PWM_BOARDS; b++)
+        bursts += pwmBursts[b];
+
+    Serial.printf("PWM bursts: %lu sent: %luB would have been: %luB saved: %luB/s\n",
+                  (unsigned long) bursts, (unsigned long) pwmSentBytes, (unsigned long) pwmRequestedBytes,
+                  (unsigned long) pwmSavedBytesPerSec);
+    for(uint8_t b = 0; b < PWM_BOARDS && PWM_BOARDS > 1; b++)
+        Serial.printf("  board %u bursts: %lu\n", b, (unsigned long) pwmBursts[b]);
 }
 
 void SetRingColor(RgbColor color){
@@ -97,7 +268,7 @@ void NeoPixelLoop(){
         //leds.ClearTo(feedBackColors[2], 4, 5);
         leds.Show();
     }else{
-        SetRingColor(safety ? RgbColor(0,0,180) : RgbColor(180,0,0));
+        SetRingColor(ctlState.safety ? RgbColor(0,0,180) : RgbColor(180,0,0));
     }
 }
 
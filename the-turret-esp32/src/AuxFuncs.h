@@ -5,7 +5,7 @@
 
 
 
-extern PCA9685 pwm;
+extern PCA9685 pwmBoards[];
 extern PCA9685_ServoEval pwmServo;
 
 void InitPWM();
@@ -14,12 +14,22 @@ void InitPins();
 
 void InitNeopixel();
 
-void WriteServo(uint8_t indx, float pos);
+void InitPaddleCounters();
+
+uint32_t ReadPaddleCount(uint8_t wing);
+
+void WriteServo(uint8_t servo, int16_t cd); // Aim servos, see ServoCal.h
 
 void WriteServoSpeed(uint8_t indx, float s);
 
 void WritePWMDuty(uint8_t, float);
 
+void WritePWMRaw(uint8_t indx, uint16_t val);
+
+void FlushPWM();
+
+void PrintPWMStats();
+
 void SetRingColor(RgbColor);
 
 void NeoPixelLoop();
\ No newline at end of file
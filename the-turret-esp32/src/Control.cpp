@@ -0,0 +1,26 @@
+#include "Control.h"
+#include "Telemetry.h"
+
+SpscQueue<ControlCmd, CONTROL_CMD_QUEUE_LEN> controlCmds;
+SpscQueue<ControlState, CONTROL_STATE_QUEUE_LEN> controlStates;
+
+ControlState ctlState = {};
+LatencyTag controlTag = {};
+
+bool SendControl(ControlCmdType type, int32_t n, float a, float b){
+    ControlCmd cmd = {type, (uint32_t) micros(), n, a, b, controlTag};
+
+    if(!controlCmds.Push(cmd)){
+        TelemLogEvent(EvControlQueueFull);
+        return false;
+    }
+    return true;
+}
+
+bool PollControlState(){
+    bool got = false;
+    while(controlStates.Pop(ctlState)) // Only the newest snapshot matters
+        got = true;
+
+    return got;
+}
@@ -0,0 +1,83 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+#include "SpscQueue.h"
+
+// The fire/wing/feed state machines run in their own task on CONTROL_CORE. Everything else (WiFi,
+// UDP, audio, LEDs, serial) runs on APP_CORE. The two sides only talk through these two queues:
+// commands go app -> control, state snapshots come back control -> app.
+
+#define CONTROL_CORE 1
+#define CONTROL_TASK_PRIO (configMAX_PRIORITIES - 5) // Above everything on its core, below esp_timer
+#define APP_CORE 0
+#define APP_TASK_PRIO 2
+
+#define CONTROL_CMD_QUEUE_LEN 32
+#define CONTROL_STATE_QUEUE_LEN 8
+#define STATE_PUBLISH_HZ 100
+
+enum ControlCmdType : uint8_t {
+    CmdAim,       // a = pitch, b = yaw
+    CmdTrack,     // a = pitch, b = yaw of a moving target, goes through the aim filter
+    CmdAimLatency,// n = ms between the host seeing the target and sending the packet
+    CmdFire,      // n = 0/1
+    CmdRev,       // n = 0/1
+    CmdBurst,     // n = shots
+    CmdWings,     // n = target WingState for every wing
+    CmdSafety,    // n = 0/1
+    CmdFireDelay, // n = ms between shots
+    CmdVolley,    // n = VolleyPattern, a = stagger offset ms (0 = spread evenly)
+    CmdServoCal   // n = ServoCalAction, a = knots/counts
+};
+
+// Where a command came from, for the latency histograms and acks in Latency.h. All zero for commands
+// that didn't come over the network (serial, self test).
+struct LatencyTag {
+    uint32_t rxUs;   // micros() when the datagram came in, 0 = not measured
+    uint8_t ackSlot; // 1 + the ack slot, 0 = no ack asked for
+};
+
+struct ControlCmd {
+    ControlCmdType type;
+    uint32_t us; // micros() when the app side received it
+    int32_t n;
+    float a;
+    float b;
+    LatencyTag lat;
+};
+
+struct ControlState {
+    uint32_t timeMs;
+
+    float pitch;
+    float yaw;
+    bool tracking;
+    float aimLeadMs;
+    bool fire;
+    bool doRev;
+    bool safety;
+    uint16_t burstCount;
+
+    WingState wingStates[WINGS];
+    WingState targetWingStates[WINGS];
+    FireState fireStates[WINGS];
+    FeedState feedStates[WINGS];
+    int16_t BBBalance[WINGS];
+    bool openSW[WINGS];
+    bool closedSW[WINGS];
+};
+
+extern SpscQueue<ControlCmd, CONTROL_CMD_QUEUE_LEN> controlCmds;
+extern SpscQueue<ControlState, CONTROL_STATE_QUEUE_LEN> controlStates;
+
+extern ControlState ctlState; // App side copy of the latest snapshot
+extern LatencyTag controlTag; // App side, goes out with every SendControl() until it's set back
+extern uint16_t fireDelayMs; // Control side, set by CmdFireDelay
+
+// App side
+bool SendControl(ControlCmdType type, int32_t n = 0, float a = 0.0f, float b = 0.0f);
+bool PollControlState();
+
+#endif
@@ -0,0 +1,50 @@
+#include "Endstops.h"
+#include "Scheduler.h"
+
+extern uint8_t closedSWPins[];
+extern uint8_t openSWPins[];
+
+EndstopLatch closedLatch[WINGS] = {};
+EndstopLatch openLatch[WINGS] = {};
+
+static portMUX_TYPE endstopMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR OnEndstop(void *arg){
+    EndstopLatch *latch = (EndstopLatch*) arg;
+
+    portENTER_CRITICAL_ISR(&endstopMux);
+    if(!latch->hit){ // Keep the first edge, the switch bounces
+        latch->us = esp_timer_get_time();
+        latch->hit = true;
+    }
+    portEXIT_CRITICAL_ISR(&endstopMux);
+
+    SchedulerNotifyFromISR(SCHED_NOTIFY_ENDSTOP);
+}
+
+void InitEndstops(){
+    for(uint8_t i = 0; i < WINGS; i++){
+        attachInterruptArg(digitalPinToInterrupt(closedSWPins[i]), OnEndstop, &closedLatch[i], RISING);  // Closed switch reads high when hit
+        attachInterruptArg(digitalPinToInterrupt(openSWPins[i]), OnEndstop, &openLatch[i], FALLING);     // Open switch pulls low
+    }
+}
+
+static bool Take(EndstopLatch &latch, uint64_t &us){
+    bool hit;
+
+    portENTER_CRITICAL(&endstopMux);
+    hit = latch.hit;
+    us = latch.us;
+    latch.hit = false;
+    portEXIT_CRITICAL(&endstopMux);
+
+    return hit;
+}
+
+bool EndstopTakeClosed(uint8_t wing, uint64_t &us){
+    return Take(closedLatch[wing], us);
+}
+
+bool EndstopTakeOpen(uint8_t wing, uint64_t &us){
+    return Take(openLatch[wing], us);
+}
@@ -0,0 +1,22 @@
+#ifndef ENDSTOPS_H
+#define ENDSTOPS_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Edge interrupts on the wing endstops. The ISR only latches which switch fired and when (us) and
+// wakes the control task with SCHED_NOTIFY_ENDSTOP, which then stops or slows the expand servo
+// right away instead of on the next WingLoop poll.
+
+#define SCHED_NOTIFY_ENDSTOP (1 << 1)
+
+struct EndstopLatch {
+    volatile bool hit;
+    volatile uint64_t us; // esp_timer time of the first edge since the last EndstopTake()
+};
+
+void InitEndstops();
+bool EndstopTakeClosed(uint8_t wing, uint64_t &us);
+bool EndstopTakeOpen(uint8_t wing, uint64_t &us);
+
+#endif
@@ -0,0 +1,51 @@
+#include "FeedControl.h"
+#include "Volley.h"
+
+float feedMeasuredHz = 0.0f;  // Paddles per second per wing, smoothed
+float feedIntegral = 0.0f;
+float feedDuty = 0.0f;
+uint32_t feedWindowStartMs = 0;
+uint32_t feedWindowPaddles = 0;
+
+// Paddle rate per wing we want: whatever it's firing at plus a margin, or a slow trickle to keep the
+// feed path primed while it's only revving
+float FeedTargetHz(bool firing, uint32_t cycleUs){
+    if(!firing)
+        return FEED_PRIME_HZ;
+    return VolleyWingHz(cycleUs) * FEED_BB_MARGIN;
+}
+
+// paddles is the running total over all wings. Returns the duty for FEEDER_MOTOR_INDX.
+float FeedControlUpdate(float targetHz, uint32_t paddles){
+    uint32_t now = millis();
+
+    if(!feedWindowStartMs){ // First pass after a reset, nothing measured yet
+        feedWindowStartMs = now;
+        feedWindowPaddles = paddles;
+        feedDuty = targetHz / FEED_PADDLE_HZ_PER_DUTY;
+    }
+
+    if(now - feedWindowStartMs >= FEED_CONTROL_WINDOW_MS){
+        float dt = (now - feedWindowStartMs) / 1000.0f;
+        float hz = (paddles - feedWindowPaddles) / (float) WINGS / dt;
+        feedMeasuredHz += (hz - feedMeasuredHz) * FEED_RATE_EMA;
+        feedWindowStartMs = now;
+        feedWindowPaddles = paddles;
+
+        float err = targetHz - feedMeasuredHz;
+        feedIntegral = constrain(feedIntegral + err * dt, -FEED_TRIM_MAX / FEED_KI, FEED_TRIM_MAX / FEED_KI);
+        float trim = constrain(FEED_KP * err + FEED_KI * feedIntegral, -FEED_TRIM_MAX, FEED_TRIM_MAX);
+
+        feedDuty = targetHz / FEED_PADDLE_HZ_PER_DUTY + trim;
+    }
+
+    feedDuty = constrain(feedDuty, FEED_MIN_DUTY, 1.0f);
+    return feedDuty;
+}
+
+void FeedControlReset(){
+    feedMeasuredHz = 0.0f;
+    feedIntegral = 0.0f;
+    feedDuty = 0.0f;
+    feedWindowStartMs = 0;
+}
@@ -0,0 +1,16 @@
+#ifndef FEED_CONTROL_H
+#define FEED_CONTROL_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Feeder motor duty from the rate the wings are actually firing at. Feed-forward from the paddle
+// rate we want (FEED_PADDLE_HZ_PER_DUTY says what a given duty usually gets us) plus a PI trim on
+// the measured paddle rate, which is limited so a full feed path (paddles stalled on purpose) can't
+// wind it up to full duty.
+
+float FeedTargetHz(bool firing, uint32_t cycleUs);
+float FeedControlUpdate(float targetHz, uint32_t paddles);
+void FeedControlReset();
+
+#endif
@@ -0,0 +1,187 @@
+#include "FireEngine.h"
+#include <esp_timer.h>
+
+extern uint8_t fireSolenoidPins[];
+
+enum FirePhase {PhaseIdle, PhaseArmed, PhaseOn};
+
+struct FireWing {
+    esp_timer_handle_t timer;
+    volatile FirePhase phase;
+    volatile uint64_t atUs;      // When the armed on edge is due
+    volatile uint64_t onAtUs;    // When the last on edge actually happened
+    volatile uint64_t lastOnUs;  // Same, but not cleared when a new string of shots starts
+    volatile uint64_t readyUs;   // End of the off time after the last pulse
+    uint32_t onUs;
+    uint32_t offUs;
+    volatile uint32_t shots;     // Completed pulses
+};
+
+FireWing fireWings[WINGS] = {};
+FireEngineStats fireStats[WINGS] = {};
+
+static portMUX_TYPE fireMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool fireResetPending = false;
+
+// Runs in the esp_timer task, both edges of a pulse go through here
+static void OnFireTimer(void *arg){
+    uint8_t i = (uint8_t) (uintptr_t) arg;
+    FireWing &w = fireWings[i];
+    FireEngineStats &s = fireStats[i];
+
+    portENTER_CRITICAL(&fireMux);
+    uint64_t now = esp_timer_get_time();
+
+    if(w.phase == PhaseArmed){
+        digitalWrite(fireSolenoidPins[i], HIGH);
+        w.phase = PhaseOn;
+
+        if(w.onAtUs){
+            s.periodUs = now - w.onAtUs;
+            if(!s.minPeriodUs || s.periodUs < s.minPeriodUs)
+                s.minPeriodUs = s.periodUs;
+            if(s.periodUs > s.maxPeriodUs)
+                s.maxPeriodUs = s.periodUs;
+        }
+        if(now > w.atUs && now - w.atUs > s.maxLateUs)
+            s.maxLateUs = now - w.atUs;
+
+        w.onAtUs = now;
+        w.lastOnUs = now;
+        esp_timer_start_once(w.timer, w.onUs);
+    }else if(w.phase == PhaseOn){
+        digitalWrite(fireSolenoidPins[i], LOW);
+        w.phase = PhaseIdle;
+        w.readyUs = now + w.offUs;
+        w.shots++;
+
+        s.shots++;
+        s.pulseErrUs = (int32_t) (now - w.onAtUs) - (int32_t) w.onUs;
+        if(abs(s.pulseErrUs) > abs(s.maxPulseErrUs))
+            s.maxPulseErrUs = s.pulseErrUs;
+    }
+    portEXIT_CRITICAL(&fireMux);
+}
+
+void InitFireEngine(){
+    for(uint8_t i = 0; i < WINGS; i++){
+        esp_timer_create_args_t args = {};
+        args.callback = OnFireTimer;
+        args.arg = (void*) (uintptr_t) i;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "fire";
+        esp_timer_create(&args, &fireWings[i].timer);
+    }
+}
+
+// Arm a pulse of onUs at atUs (or as soon as possible if that's already gone), followed by offUs
+// before the wing reports Ready again. Can be armed during the last shot's off time, it won't go
+// off before that's over. Fails if a shot is already armed or the solenoid is on.
+bool FireEngineShot(uint8_t wing, uint64_t atUs, uint32_t onUs, uint32_t offUs){
+    FireWing &w = fireWings[wing];
+
+    if(!FireEngineCanArm(wing))
+        return false;
+
+    uint64_t now = esp_timer_get_time();
+    if(atUs < w.readyUs)
+        atUs = w.readyUs;
+
+    portENTER_CRITICAL(&fireMux);
+    if(atUs <= now){ // Not following on from another shot, don't count the gap as a period
+        atUs = now;
+        for(uint8_t i = 0; i < WINGS; i++)
+            fireWings[i].onAtUs = 0;
+    }
+    w.phase = PhaseArmed;
+    w.atUs = atUs;
+    w.onUs = onUs;
+    w.offUs = offUs;
+    portEXIT_CRITICAL(&fireMux);
+
+    esp_timer_start_once(w.timer, atUs - now);
+    return true;
+}
+
+// Drop an armed shot that hasn't started yet, a pulse in progress is left to finish
+bool FireEngineCancel(uint8_t wing){
+    FireWing &w = fireWings[wing];
+    bool cancelled = false;
+
+    portENTER_CRITICAL(&fireMux);
+    if(w.phase == PhaseArmed){
+        esp_timer_stop(w.timer);
+        w.phase = PhaseIdle;
+        cancelled = true;
+    }
+    portEXIT_CRITICAL(&fireMux);
+
+    return cancelled;
+}
+
+// Solenoid off now, whatever it was doing
+void FireEngineStop(uint8_t wing){
+    FireWing &w = fireWings[wing];
+
+    portENTER_CRITICAL(&fireMux);
+    esp_timer_stop(w.timer);
+    if(w.phase == PhaseOn)
+        w.readyUs = esp_timer_get_time() + w.offUs;
+    w.phase = PhaseIdle;
+    digitalWrite(fireSolenoidPins[wing], LOW);
+    portEXIT_CRITICAL(&fireMux);
+}
+
+bool FireEngineCanArm(uint8_t wing){
+    return fireWings[wing].phase == PhaseIdle;
+}
+
+bool FireEngineIdle(uint8_t wing){
+    return fireWings[wing].phase == PhaseIdle && (uint64_t) esp_timer_get_time() >= fireWings[wing].readyUs;
+}
+
+FireState FireEngineState(uint8_t wing){
+    FireWing &w = fireWings[wing];
+
+    if(w.phase == PhaseOn)
+        return SolOn;
+    if((uint64_t) esp_timer_get_time() < w.readyUs) // Even if the next one is already armed
+        return SolOff;
+    return Ready;
+}
+
+uint32_t FireEngineShots(uint8_t wing){
+    return fireWings[wing].shots;
+}
+
+uint64_t FireEngineLastOnUs(uint8_t wing){
+    return fireWings[wing].lastOnUs;
+}
+
+// Every control tick
+void FireEngineLoop(){
+    if(!fireResetPending)
+        return;
+    fireResetPending = false;
+
+    portENTER_CRITICAL(&fireMux);
+    for(uint8_t i = 0; i < WINGS; i++){
+        fireStats[i] = {};
+        fireWings[i].onAtUs = 0;
+    }
+    portEXIT_CRITICAL(&fireMux);
+}
+
+void FireEngineResetStats(){
+    fireResetPending = true; // Done by FireEngineLoop(), the control task arms the shots the stats come from
+}
+
+void FireEnginePrintStats(){
+    for(uint8_t i = 0; i < WINGS; i++){
+        FireEngineStats s = fireStats[i];
+        Serial.printf("Fire %u shots: %6lu rate: %5.2f/s period min: %6luus max: %6luus pulse err: %4ldus max: %4ldus late max: %4luus\n",
+                      i, (unsigned long) s.shots, s.periodUs ? 1000000.0f / s.periodUs : 0.0f,
+                      (unsigned long) s.minPeriodUs, (unsigned long) s.maxPeriodUs,
+                      (long) s.pulseErrUs, (long) s.maxPulseErrUs, (unsigned long) s.maxLateUs);
+    }
+}
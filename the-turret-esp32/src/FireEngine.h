@@ -0,0 +1,35 @@
+#ifndef FIRE_ENGINE_H
+#define FIRE_ENGINE_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Solenoid pulses timed by esp_timer one-shots instead of FireLoop polling millis(). A shot is armed
+// for an absolute time, the timer callback drives the on edge and schedules the off edge from when
+// the on edge actually happened, so the pulse width doesn't depend on how late the control loop is.
+// The off time after the pulse is only a timestamp, FireEngineState() reports SolOff until it passes.
+
+struct FireEngineStats {
+    uint32_t shots;
+    uint32_t periodUs;    // On edge to on edge while firing continuously, last shot
+    uint32_t minPeriodUs;
+    uint32_t maxPeriodUs;
+    int32_t pulseErrUs;   // Achieved minus asked pulse width, last shot
+    int32_t maxPulseErrUs;
+    uint32_t maxLateUs;   // How far after its armed time an on edge happened
+};
+
+void InitFireEngine();
+bool FireEngineShot(uint8_t wing, uint64_t atUs, uint32_t onUs, uint32_t offUs);
+bool FireEngineCancel(uint8_t wing);
+void FireEngineStop(uint8_t wing);
+bool FireEngineCanArm(uint8_t wing);
+bool FireEngineIdle(uint8_t wing);
+FireState FireEngineState(uint8_t wing);
+uint32_t FireEngineShots(uint8_t wing);
+uint64_t FireEngineLastOnUs(uint8_t wing);
+void FireEngineLoop();
+void FireEngineResetStats();
+void FireEnginePrintStats();
+
+#endif
@@ -7,11 +7,16 @@
 #include "PinsAndDefs.h"
 
 
-PCA9685 pwm(Wire); //Default 0x40 Address
+PCA9685 pwmBoards[PWM_BOARDS] = {
+    PCA9685(0x00, Wire), //Address bits A5-A0, board 0 is the default 0x40
+#if PWM_BOARDS > 1
+    PCA9685(0x01, Wire), //A0 bridged, left head
+#endif
+};
 PCA9685_ServoEval pwmServo;
 
 
-INA226 currSens[2] = {INA226(0x41), INA226(0x44)};
+INA226 currSens[WINGS] = {INA226(0x41, &Wire1), INA226(0x44, &Wire1)}; // Own bus, see POWER_I2C_SDA
 
 NeoPixelBus<NeoGrbFeature, NeoWs2812xMethod> leds(12, NEOPIXEL_RING_PIN);
 NeoGamma<NeoGammaTableMethod> gammaCorr;
@@ -27,18 +32,28 @@ uint16_t fireDelays[3] = {FIRE_DELAY_FAST, FIRE_DELAY_MEDIUM, FIRE_DELAY_SLOW};
 
 RgbColor feedBackColors[] = {RgbColor(207, 0, 0), RgbColor(209, 194, 27), RgbColor(65, 224, 11)};
 
-uint8_t feederSensePins[2] = {FEEDER_SENSE_R, FEEDER_SENSE_L};
-uint8_t fireSolenoidPins[2] = {FIRE_SOLENOID_PIN_R, FIRE_SOLENOID_PIN_L};
+uint8_t feederSensePins[WINGS] = {FEEDER_SENSE_R, FEEDER_SENSE_L};
+uint8_t fireSolenoidPins[WINGS] = {FIRE_SOLENOID_PIN_R, FIRE_SOLENOID_PIN_L};
 
-uint8_t revIndxs[2] = {REV_INDX_R, REV_INDX_L};
+uint8_t revIndxs[WINGS] = {REV_INDX_R, REV_INDX_L};
 
 
-uint8_t expServoIndxs[2] = {EXPAND_SERVO_INDEX_R, EXPAND_SERVO_INDEX_L};
-uint8_t pitchServoIndxs[2] = {PITCH_SERVO_INDEX_R, PITCH_SERVO_INDEX_L};
-uint8_t yawServoIndxs[2] = {YAW_SERVO_INDEX_R, YAW_SERVO_INDEX_L};
+uint8_t expServoIndxs[WINGS] = {EXPAND_SERVO_INDEX_R, EXPAND_SERVO_INDEX_L};
+uint8_t pitchServoIndxs[WINGS] = {PITCH_SERVO_INDEX_R, PITCH_SERVO_INDEX_L};
+uint8_t yawServoIndxs[WINGS] = {YAW_SERVO_INDEX_R, YAW_SERVO_INDEX_L};
 
-uint8_t closedSWPins[2] = {ENDSTOP_CLOSE_R, ENDSTOP_CLOSE_L};
-uint8_t openSWPins[2] = {ENDSTOP_OPEN_R, ENDSTOP_OPEN_L};
+uint8_t closedSWPins[WINGS] = {ENDSTOP_CLOSE_R, ENDSTOP_CLOSE_L};
+uint8_t openSWPins[WINGS] = {ENDSTOP_OPEN_R, ENDSTOP_OPEN_L};
 
-float pitchOffts[2] = {PITCH_OFFSET_R, PITCH_OFFSET_L};
-float yawOffts[2] = {YAW_OFFSET_R, YAW_OFFSET_L};
\ No newline at end of file
+float pitchOffts[WINGS] = {PITCH_OFFSET_R, PITCH_OFFSET_L};
+float yawOffts[WINGS] = {YAW_OFFSET_R, YAW_OFFSET_L};
+
+float pitchMaxVel[WINGS] = {PITCH_MAX_VEL_R, PITCH_MAX_VEL_L};
+float pitchMaxAcc[WINGS] = {PITCH_MAX_ACC_R, PITCH_MAX_ACC_L};
+float yawMaxVel[WINGS] = {YAW_MAX_VEL_R, YAW_MAX_VEL_L};
+float yawMaxAcc[WINGS] = {YAW_MAX_ACC_R, YAW_MAX_ACC_L};
+
+// The left wing is mirrored, its pitch runs the other way and its yaw range is flipped
+float pitchSigns[WINGS] = {1.0f, -1.0f};
+float yawMinAngles[WINGS] = {YAW_MIN_ANGLE, -YAW_MAX_ANGLE};
+float yawMaxAngles[WINGS] = {YAW_MAX_ANGLE, -YAW_MIN_ANGLE};
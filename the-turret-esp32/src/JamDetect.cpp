@@ -0,0 +1,93 @@
+#include "JamDetect.h"
+
+JamDetector jamDetect[WINGS] = {};
+
+extern uint32_t paddleBounces[];
+
+static float Sigmoid(float z){
+    return 1.0f / (1.0f + expf(-z));
+}
+
+// Forget the evidence, after a recovery we start from scratch. Counters stay.
+void JamDetectReset(uint8_t wing){
+    JamDetector &d = jamDetect[wing];
+
+    d.lastPaddleMs = millis();
+    d.starvedShots = 0;
+    d.dryEma = 0.0f;
+    d.inShot = false;
+    d.jamProb = 0.0f;
+    d.clumpProb = 0.0f;
+}
+
+void JamDetectUpdate(uint8_t wing, uint32_t paddles, FireState fireState, const PowerSnapshot &power){
+    JamDetector &d = jamDetect[wing];
+    uint32_t now = millis();
+
+    if(paddles != d.paddles){
+        if(d.lastPaddleMs && d.paddles){
+            float interval = (now - d.lastPaddleMs) / (float) (paddles - d.paddles);
+            d.paddleIntervalMs = d.paddleIntervalMs ? d.paddleIntervalMs + (interval - d.paddleIntervalMs) * JAM_PADDLE_EMA : interval;
+        }
+        d.paddles = paddles;
+        d.lastPaddleMs = now;
+        d.starvedShots = 0;
+    }
+
+    if(power.sample != d.lastSample){
+        float ma = power.wing[wing].currentMA;
+        if(d.inShot && d.lastSample && ma - d.prevMA[1] > d.shotRiseMA)
+            d.shotRiseMA = ma - d.prevMA[1];
+
+        d.prevMA[1] = d.prevMA[0];
+        d.prevMA[0] = ma;
+        d.lastSample = power.sample;
+    }
+
+    if(d.inShot && d.lastFireState == SolOff && fireState != SolOff){ // Shot done, did a BB go through?
+        bool dry = d.shotRiseMA < JAM_SHOT_RISE_MA;
+
+        d.inShot = false;
+        d.shots++;
+        d.dryShots += dry;
+        d.dryEma += ((dry ? 1.0f : 0.0f) - d.dryEma) * JAM_DRY_EMA;
+        if(d.starvedShots < 255)
+            d.starvedShots++;
+    }
+
+    if(fireState == SolOn && !d.inShot){ // Back to back shots go straight from SolOff to SolOn
+        d.inShot = true;
+        d.shotRiseMA = 0.0f;
+    }
+    d.lastFireState = fireState;
+
+    float overdue = 0.0f;
+    if(d.starvedShots && d.paddleIntervalMs)
+        overdue = constrain((now - d.lastPaddleMs) / d.paddleIntervalMs - 1.0f, 0.0f, JAM_STALL_CAP);
+
+    d.jamProb = Sigmoid(JAM_BIAS + JAM_W_STARVED * d.starvedShots + JAM_W_STALL * overdue + JAM_W_DRY * d.dryEma);
+    d.clumpProb = Sigmoid(CLUMP_BIAS + CLUMP_W_DRY * d.dryEma - CLUMP_W_STARVED * d.starvedShots);
+}
+
+FeedState JamDetectVerdict(uint8_t wing){
+    JamDetector &d = jamDetect[wing];
+
+    if(d.jamProb >= JAM_TRIGGER_PROB && d.jamProb >= d.clumpProb){
+        d.jams++;
+        return Jam;
+    }
+    if(d.clumpProb >= JAM_TRIGGER_PROB){
+        d.clumps++;
+        return Clump;
+    }
+    return Nominal;
+}
+
+void JamDetectPrintStats(){
+    for(uint8_t i = 0; i < WINGS; i++){
+        JamDetector &d = jamDetect[i];
+        Serial.printf("Feed %u P(jam): %.2f P(clump): %.2f shots: %lu dry: %lu jams: %lu clumps: %lu paddle interval: %.0fms bounces: %lu\n",
+                      i, d.jamProb, d.clumpProb, (unsigned long) d.shots, (unsigned long) d.dryShots,
+                      (unsigned long) d.jams, (unsigned long) d.clumps, d.paddleIntervalMs, (unsigned long) paddleBounces[i]);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef JAM_DETECT_H
+#define JAM_DETECT_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+#include "PowerSampler.h"
+
+// Per wing jam/clump estimate, fed once per FeedLoop pass with constant memory. BBBalance on its own
+// drifts (the paddles move more BBs than we fire), so this looks at three things instead:
+//  - starvation: shots fired since the paddles last moved, and how overdue the next paddle is
+//    compared to the usual paddle interval
+//  - dry shots: a BB going through the flywheels loads them, so the rev current jumps right after
+//    the solenoid. A shot without that jump most likely had nothing in front of it
+// Dry shots with the paddles stopped look like a jam, dry shots with the paddles turning look like
+// a clump (BBs moving but not reaching the chamber). Each is squashed into a 0..1 probability.
+
+struct JamDetector {
+    uint32_t paddles;
+    uint32_t lastPaddleMs;
+    float paddleIntervalMs;   // Smoothed time between paddles while they're moving
+    uint8_t starvedShots;     // Shots since the paddles last moved
+    float dryEma;             // Recent fraction of shots with no current jump
+    bool inShot;
+    FireState lastFireState;
+    float shotRiseMA;         // Biggest current jump seen during this shot
+    float prevMA[2];          // Last two samples, for the jump
+    uint32_t lastSample;
+    float jamProb;
+    float clumpProb;
+    uint32_t shots;
+    uint32_t dryShots;
+    uint32_t jams;
+    uint32_t clumps;
+};
+
+void JamDetectReset(uint8_t wing);
+void JamDetectUpdate(uint8_t wing, uint32_t paddles, FireState fireState, const PowerSnapshot &power);
+FeedState JamDetectVerdict(uint8_t wing);
+void JamDetectPrintStats();
+
+#endif
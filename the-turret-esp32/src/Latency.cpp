@@ -0,0 +1,178 @@
+#include <esp_timer.h>
+#include "Latency.h"
+#include "FireEngine.h"
+#include "Telemetry.h"
+
+struct LatencySlot {
+    bool used;
+    uint8_t opcode;
+    uint16_t seq;
+    uint32_t senderUs;
+    uint32_t rxUs;
+    IPAddress ip;
+    uint16_t port;
+};
+
+struct PendingFire {
+    bool valid;
+    LatencyTag lat;
+    uint64_t appliedUs; // esp_timer time, the clock FireEngineLastOnUs() is on
+};
+
+static const char *latencyNames[LAT_KINDS] = {"command", "fire"};
+
+LatencyHist latencyHists[LAT_KINDS] = {};
+SpscQueue<LatencyAck, LAT_ACK_QUEUE_LEN> latencyAcks;
+
+// App side
+LatencySlot latencySlots[LAT_ACK_SLOTS] = {};
+uint8_t latencyNextSlot = 0;
+uint32_t latencyAcksAsked = 0;
+uint32_t latencyAcksSent = 0;
+
+// Control side
+PendingFire pendingFire = {};
+uint32_t latencyFireTimeouts = 0;
+volatile bool latencyResetPending = false;
+
+LatencyTag LatencyTagFrame(const TpFrame &f, uint32_t rxUs, const IPAddress &ip, uint16_t port){
+    if(!(f.flags & TP_FLAG_ACK))
+        return {rxUs, 0};
+
+    uint8_t i = latencyNextSlot;
+    latencyNextSlot = (latencyNextSlot + 1) % LAT_ACK_SLOTS;
+    latencySlots[i] = {true, f.opcode, f.seq, f.senderUs, rxUs, ip, port};
+    latencyAcksAsked++;
+
+    return {rxUs, (uint8_t) (i + 1)};
+}
+
+bool LatencyNextAck(TpAckFrame &ack, IPAddress &ip, uint16_t &port){
+    LatencyAck a;
+    while(latencyAcks.Pop(a)){
+        LatencySlot &s = latencySlots[a.ackSlot - 1];
+        if(!s.used || s.rxUs != a.rxUs) // Given to a newer frame before this one got acted on
+            continue;
+        s.used = false;
+
+        ack = {TP_MAGIC, TP_VERSION, TP_ACK, s.opcode, s.seq, s.senderUs, a.rxUs, a.actUs};
+        ip = s.ip;
+        port = s.port;
+        latencyAcksSent++;
+        return true;
+    }
+    return false;
+}
+
+static void LatencyRecord(LatencyKind kind, const LatencyTag &lat, uint32_t actUs){
+    uint32_t us = actUs - lat.rxUs;
+    LatencyHist &h = latencyHists[kind];
+
+    uint8_t b = 0;
+    while(b < LAT_BUCKETS - 1 && us >= (2UL << b))
+        b++;
+    h.counts[b]++;
+
+    if(!h.n || us < h.minUs)
+        h.minUs = us;
+    if(us > h.maxUs)
+        h.maxUs = us;
+    h.totalUs += us;
+    h.n++;
+
+    if(lat.ackSlot && !latencyAcks.Push({lat.ackSlot, lat.rxUs, actUs}))
+        TelemLogEvent(EvControlQueueFull);
+}
+
+// Right after the command was taken off controlCmds
+void LatencyApplied(const ControlCmd &cmd){
+    if(!cmd.lat.rxUs)
+        return;
+
+    if(cmd.type == CmdFire && cmd.n){ // Acted on once a solenoid actually goes, a newer one takes over
+        pendingFire = {true, cmd.lat, (uint64_t) esp_timer_get_time()};
+        return;
+    }
+    LatencyRecord(LatCommand, cmd.lat, micros());
+}
+
+// Every control tick, picks up the first on edge after a fire on
+void LatencyLoop(){
+    if(latencyResetPending){
+        latencyResetPending = false;
+        for(uint8_t k = 0; k < LAT_KINDS; k++)
+            latencyHists[k] = {};
+        latencyFireTimeouts = 0;
+    }
+
+    if(!pendingFire.valid)
+        return;
+
+    uint64_t firstUs = 0;
+    for(uint8_t i = 0; i < WINGS; i++){
+        uint64_t onUs = FireEngineLastOnUs(i); // 0 for a wing that never fired
+        if(onUs && onUs >= pendingFire.appliedUs && (!firstUs || onUs < firstUs))
+            firstUs = onUs;
+    }
+
+    if(firstUs){
+        LatencyRecord(LatFire, pendingFire.lat, (uint32_t) firstUs); // micros() is the low half, same as rxUs
+        pendingFire.valid = false;
+    }else if((uint64_t) esp_timer_get_time() - pendingFire.appliedUs > LAT_FIRE_TIMEOUT_MS * 1000ULL){
+        latencyFireTimeouts++;
+        pendingFire.valid = false;
+    }
+}
+
+// Upper edge of the bucket the pct'th percentile falls in, 0 with nothing recorded
+uint32_t LatencyPercentileUs(LatencyKind kind, uint8_t pct){
+    const LatencyHist &h = latencyHists[kind];
+    if(!h.n)
+        return 0;
+
+    uint32_t want = ((uint64_t) h.n * pct + 99) / 100;
+    uint32_t seen = 0;
+    for(uint8_t b = 0; b < LAT_BUCKETS - 1; b++){
+        seen += h.counts[b];
+        if(seen >= want)
+            return min(2UL << b, (unsigned long) h.maxUs);
+    }
+    return h.maxUs;
+}
+
+size_t LatencyFormat(char *buf, size_t len){
+    size_t n = 0;
+    for(uint8_t k = 0; k < LAT_KINDS && n < len; k++){
+        const LatencyHist &h = latencyHists[k];
+        n += snprintf(buf + n, len - n, "lat %s n %lu min %lu p50 %lu p99 %lu max %lu us\n", latencyNames[k], (unsigned long) h.n,
+                      (unsigned long) h.minUs, (unsigned long) LatencyPercentileUs((LatencyKind) k, 50),
+                      (unsigned long) LatencyPercentileUs((LatencyKind) k, 99), (unsigned long) h.maxUs);
+    }
+    return min(n, len);
+}
+
+void LatencyPrintStats(){
+    Serial.printf("Latency acks asked: %lu sent: %lu dropped: %lu fire on without a shot: %lu\n", (unsigned long) latencyAcksAsked,
+                  (unsigned long) latencyAcksSent, (unsigned long) latencyAcks.Dropped(), (unsigned long) latencyFireTimeouts);
+
+    for(uint8_t k = 0; k < LAT_KINDS; k++){
+        const LatencyHist &h = latencyHists[k];
+        Serial.printf("Latency %s n: %lu min: %luus avg: %luus p50: %luus p99: %luus max: %luus\n", latencyNames[k],
+                      (unsigned long) h.n, (unsigned long) h.minUs, (unsigned long) (h.n ? h.totalUs / h.n : 0),
+                      (unsigned long) LatencyPercentileUs((LatencyKind) k, 50), (unsigned long) LatencyPercentileUs((LatencyKind) k, 99),
+                      (unsigned long) h.maxUs);
+
+        for(uint8_t b = 0; b < LAT_BUCKETS; b++){
+            if(!h.counts[b])
+                continue;
+            if(b < LAT_BUCKETS - 1)
+                Serial.printf("  <%7luus %lu\n", 2UL << b, (unsigned long) h.counts[b]);
+            else
+                Serial.printf("  >=%6luus %lu\n", 1UL << b, (unsigned long) h.counts[b]);
+        }
+    }
+}
+
+void LatencyResetStats(){
+    latencyResetPending = true; // Done by LatencyLoop(), the control task owns the histograms
+}
@@ -0,0 +1,53 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+#include "Control.h"
+#include "SpscQueue.h"
+#include "TurretProtocol.h"
+
+// How long network commands take from the datagram coming in to the turret acting on them. OnPacket
+// stamps the receive time, which rides along in ControlCmd.lat. The control task stamps the actuation
+// time: the next solenoid on edge for fire on, taking the command off the queue for everything else.
+// The difference goes into a log2 histogram per kind that only the control task writes.
+//
+// Frames with TP_FLAG_ACK also get an ack slot on the app side holding what the TpAckFrame echoes.
+// The control task hands the actuation time back through latencyAcks and ServerLoop() sends the ack.
+
+#define LAT_BUCKETS 20           // Bucket i counts delays under 2^(i+1) us, the last one everything longer
+#define LAT_ACK_SLOTS 16         // Acks waiting on the control task, the oldest gets reused
+#define LAT_ACK_QUEUE_LEN 16
+#define LAT_FIRE_TIMEOUT_MS 3000 // Fire on that never led to a shot (safety on, not revved, wings closed)
+
+enum LatencyKind : uint8_t {LatCommand, LatFire, LAT_KINDS};
+
+struct LatencyHist {
+    uint32_t counts[LAT_BUCKETS];
+    uint32_t n;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+struct LatencyAck { // control -> app
+    uint8_t ackSlot;
+    uint32_t rxUs;  // To tell a slot that was reused in the meantime
+    uint32_t actUs;
+};
+
+extern LatencyHist latencyHists[LAT_KINDS];
+extern SpscQueue<LatencyAck, LAT_ACK_QUEUE_LEN> latencyAcks;
+
+// App side
+LatencyTag LatencyTagFrame(const TpFrame &f, uint32_t rxUs, const IPAddress &ip, uint16_t port);
+bool LatencyNextAck(TpAckFrame &ack, IPAddress &ip, uint16_t &port);
+uint32_t LatencyPercentileUs(LatencyKind kind, uint8_t pct);
+size_t LatencyFormat(char *buf, size_t len);
+void LatencyPrintStats();
+void LatencyResetStats();
+
+// Control side
+void LatencyApplied(const ControlCmd &cmd);
+void LatencyLoop();
+
+#endif
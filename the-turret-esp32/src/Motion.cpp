@@ -0,0 +1,42 @@
+#include "Motion.h"
+
+#define PROFILE_SETTLE_DEG 0.05f
+
+void InitProfile(AxisProfile &ax, float pos, float maxVel, float maxAcc){
+    ax.maxVel = maxVel;
+    ax.maxAcc = maxAcc;
+    ResetProfile(ax, pos);
+}
+
+void ResetProfile(AxisProfile &ax, float pos){
+    ax.pos = pos;
+    ax.vel = 0.0f;
+}
+
+float StepProfile(AxisProfile &ax, float target, float dt){
+    float err = target - ax.pos;
+    float dv = ax.maxAcc * dt;
+
+    if(fabsf(err) < PROFILE_SETTLE_DEG && fabsf(ax.vel) <= dv){
+        ResetProfile(ax, target);
+        return ax.pos;
+    }
+
+    // Fastest speed we can still brake from before reaching the target, v^2 = 2*a*d
+    float want = sqrtf(2.0f * ax.maxAcc * fabsf(err));
+    if(want > ax.maxVel)
+        want = ax.maxVel;
+    if(err < 0.0f)
+        want = -want;
+
+    ax.vel += constrain(want - ax.vel, -dv, dv);
+
+    float step = ax.vel * dt;
+    if((err > 0.0f && step >= err) || (err < 0.0f && step <= err)){ // Would go past it, land on it instead
+        ResetProfile(ax, target);
+        return ax.pos;
+    }
+
+    ax.pos += step;
+    return ax.pos;
+}
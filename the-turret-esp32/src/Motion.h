@@ -0,0 +1,21 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <Arduino.h>
+
+// Velocity and acceleration limited setpoint generator, one per servo axis. Every control tick it
+// moves pos towards the target along a trapezoidal profile: accelerate at maxAcc up to maxVel,
+// then brake in time to stop on the target instead of overshooting it.
+
+struct AxisProfile {
+    float pos;    // deg, what gets written to the servo
+    float vel;    // deg/s
+    float maxVel; // deg/s
+    float maxAcc; // deg/s^2
+};
+
+void InitProfile(AxisProfile &ax, float pos, float maxVel, float maxAcc);
+void ResetProfile(AxisProfile &ax, float pos);
+float StepProfile(AxisProfile &ax, float target, float dt);
+
+#endif
@@ -0,0 +1,136 @@
+#include "MotorStart.h"
+#include "AuxFuncs.h"
+#include "PowerSampler.h"
+
+extern uint8_t revIndxs[];
+
+MotorStarter motors[MOTORS] = {};
+uint32_t motorLastStartMs = 0;
+uint32_t motorHeldSteps = 0; // Ramp steps skipped for being over budget or under voltage
+volatile bool motorResetPending = false;
+
+static uint8_t MotorPWMIndx(uint8_t motor){
+    if(motor == MOTOR_FEEDER)
+        return FEEDER_MOTOR_INDX;
+    if(motor == MOTOR_FEEDER_AUX)
+        return FEEDER_AUX_INDX;
+    return revIndxs[motor];
+}
+
+static float MotorInrushMA(uint8_t motor){
+    return motor < WINGS ? MOTOR_REV_INRUSH_MA : MOTOR_FEEDER_INRUSH_MA;
+}
+
+static void MotorWrite(uint8_t motor, float duty){
+    motors[motor].duty = duty;
+    WritePWMDuty(MotorPWMIndx(motor), duty);
+}
+
+void MotorSetDuty(uint8_t motor, float duty){
+    MotorStarter &m = motors[motor];
+    m.target = duty;
+
+    if(duty <= 0.0f){
+        m.state = MotorOff;
+        MotorWrite(motor, 0.0f);
+        return;
+    }
+
+    if(m.state == MotorOff){
+        m.state = MotorWaiting;
+        m.waitMs = millis();
+    }
+
+    if(m.state == MotorRunning)
+        MotorWrite(motor, duty);
+    else if(m.state == MotorRamping && m.duty > duty) // Asked for less than we've ramped to already
+        MotorWrite(motor, duty);
+}
+
+bool MotorStarted(uint8_t motor){
+    return motors[motor].state == MotorRamping || motors[motor].state == MotorRunning;
+}
+
+void MotorStartLoop(){
+    if(motorResetPending){
+        motorResetPending = false;
+        motorHeldSteps = 0;
+        for(uint8_t i = 0; i < MOTORS; i++){
+            motors[i].starts = 0;
+            motors[i].forced = 0;
+            motors[i].maxWaitMs = 0;
+        }
+    }
+
+    PowerSnapshot power;
+    PowerRead(power);
+
+    float totalMA = motors[MOTOR_FEEDER].duty * MOTOR_FEEDER_MA + motors[MOTOR_FEEDER_AUX].duty * MOTOR_FEEDER_AUX_MA;
+    float minBusMV = 1e9f;
+    for(uint8_t i = 0; i < WINGS; i++){
+        totalMA += power.wing[i].currentMA;
+        if(power.sample)
+            minBusMV = min(minBusMV, power.wing[i].busV * 1000.0f);
+    }
+
+    bool ok = totalMA < MOTOR_CURRENT_BUDGET_MA && minBusMV >= MOTOR_MIN_BUS_MV;
+    bool ramping = false;
+
+    for(uint8_t i = 0; i < MOTORS; i++){
+        MotorStarter &m = motors[i];
+        if(m.state != MotorRamping)
+            continue;
+
+        if(!ok){
+            motorHeldSteps++;
+            ramping = true;
+            continue;
+        }
+
+        float duty = m.duty + MOTOR_RAMP_PER_S / MOTOR_START_HZ;
+        if(duty >= m.target){
+            duty = m.target;
+            m.state = MotorRunning;
+        }else{
+            ramping = true;
+        }
+        MotorWrite(i, duty);
+    }
+
+    // Lowest index first, so the flywheels go before the feeder
+    uint32_t now = millis();
+    if(now - motorLastStartMs < MOTOR_STAGGER_MS)
+        return;
+
+    for(uint8_t i = 0; i < MOTORS; i++){
+        MotorStarter &m = motors[i];
+        if(m.state != MotorWaiting)
+            continue;
+
+        uint32_t waited = now - m.waitMs;
+        bool forced = waited >= MOTOR_START_MAX_WAIT_MS;
+        if(!forced && (ramping || !ok || totalMA + MotorInrushMA(i) > MOTOR_CURRENT_BUDGET_MA))
+            continue;
+
+        m.state = MotorRamping;
+        m.starts++;
+        m.forced += forced;
+        if(waited > m.maxWaitMs)
+            m.maxWaitMs = waited;
+        motorLastStartMs = now;
+        return; // One per stagger, the ramp starts on the next step
+    }
+}
+
+void MotorStartPrintStats(){
+    Serial.printf("Motors held ramp steps: %lu\n", (unsigned long) motorHeldSteps);
+    for(uint8_t i = 0; i < MOTORS; i++){
+        MotorStarter &m = motors[i];
+        Serial.printf("Motor %u state: %u duty: %.2f starts: %lu forced: %lu max wait: %lums\n",
+                      i, m.state, m.duty, (unsigned long) m.starts, (unsigned long) m.forced, (unsigned long) m.maxWaitMs);
+    }
+}
+
+void MotorStartResetStats(){
+    motorResetPending = true; // Done by MotorStartLoop(), the control task owns the starters
+}
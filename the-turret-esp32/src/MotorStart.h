@@ -0,0 +1,39 @@
+#ifndef MOTOR_START_H
+#define MOTOR_START_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Keeps the motor inrush under MOTOR_CURRENT_BUDGET_MA so the bus never sags enough to brown out the
+// ESP32. Callers ask for a duty with MotorSetDuty() and the duty actually written lags behind it.
+// A motor starting from stopped waits in line, and only one motor ramps up at a time. The next one
+// is let in once the INA226s show enough headroom for its inrush. While a ramp is running it only
+// goes up when the measured current is under budget and the bus is above MOTOR_MIN_BUS_MV.
+// Motors already running follow their duty straight away.
+//
+// The INA226s only see the flywheels, so the feeder motors count at a fixed current per unit of duty.
+
+#define MOTOR_REV(wing) (wing)
+#define MOTOR_FEEDER WINGS
+#define MOTOR_FEEDER_AUX (WINGS + 1)
+#define MOTORS (WINGS + 2)
+
+enum MotorStartState : uint8_t {MotorOff, MotorWaiting, MotorRamping, MotorRunning};
+
+struct MotorStarter {
+    MotorStartState state;
+    float target;       // What the caller asked for
+    float duty;         // What is on the PWM channel
+    uint32_t waitMs;    // When it started waiting
+    uint32_t starts;
+    uint32_t forced;    // Started without the headroom after MOTOR_START_MAX_WAIT_MS
+    uint32_t maxWaitMs;
+};
+
+void MotorSetDuty(uint8_t motor, float duty);
+bool MotorStarted(uint8_t motor); // Ramping or running
+void MotorStartLoop();
+void MotorStartPrintStats();
+void MotorStartResetStats();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+// Collision free lookup of a fixed set of names, built at compile time. MakePerfectHash() tries
+// seeds until every name lands in its own slot, then Find() is one hash, one slot read and one
+// compare. Entry can be any struct with a std::string_view name.
+//
+//   constexpr auto hash = MakePerfectHash<64>(entries);
+//   static_assert(hash.seed, "No perfect hash, make the table bigger");
+
+constexpr uint32_t PerfectHashOf(std::string_view s, uint32_t seed){
+    uint32_t h = 2166136261u ^ seed; // FNV-1a
+    for(char c : s){
+        h ^= (uint8_t) c;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+template<size_t Size> struct PerfectHash {
+    static_assert((Size & (Size - 1)) == 0, "Size has to be a power of two");
+
+    uint32_t seed = 0;     // 0 = none found
+    uint8_t slot[Size] = {}; // Entry index + 1, 0 = empty
+
+    template<typename Entry, size_t N>
+    constexpr const Entry *Find(const Entry (&entries)[N], std::string_view name) const {
+        uint8_t i = slot[PerfectHashOf(name, seed) & (Size - 1)];
+        return i && entries[i - 1].name == name ? &entries[i - 1] : nullptr;
+    }
+};
+
+template<size_t Size, typename Entry, size_t N>
+constexpr PerfectHash<Size> MakePerfectHash(const Entry (&entries)[N]){
+    static_assert(N < Size && N < 255, "Table too small for the names");
+
+    for(uint32_t seed = 1; seed < 10000; seed++){
+        PerfectHash<Size> h;
+        h.seed = seed;
+
+        bool ok = true;
+        for(size_t i = 0; i < N && ok; i++){
+            uint8_t &s = h.slot[PerfectHashOf(entries[i].name, seed) & (Size - 1)];
+            ok = !s;
+            s = i + 1;
+        }
+        if(ok)
+            return h;
+    }
+    return PerfectHash<Size>();
+}
+
+#endif
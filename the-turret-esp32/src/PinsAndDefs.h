@@ -4,7 +4,14 @@
 
 #define FIRE_ON_MS 70
 #define FIRE_OFF_MS 30
-#define FIRE_REV_MS 3000
+#define FIRE_REV_MS 3000 // Longest we wait for the flywheels, see RevDetect.h for the usual case
+
+#define REV_DETECT_MIN_MS 150    // Don't judge anything during the inrush itself
+#define REV_DETECT_EMA 0.3f
+#define REV_INRUSH_MIN_MA 1500   // A smaller peak means the sensor isn't seeing the motor, wait for FIRE_REV_MS
+#define REV_SETTLE_FRAC 0.12f    // Current has to fall to this much of the inrush peak
+#define REV_SAG_READY_MV 60      // and the bus be back within this of its resting voltage
+#define REV_SETTLE_SAMPLES 3
 
 #define FIRE_DELAY_SLOW 200
 #define FIRE_DELAY_MEDIUM 60
@@ -16,10 +23,23 @@
 #define FIRE_REV_IDLE_COEF 0.7f
 #define FIRE_REV_ACTIVE_COEF 1.0f
 
-#define BBBALANCE_CLUMP_THRESHOLD 2
-#define BBBALANCE_JAM_THRESHOLD 5
+// Jam/clump detection, see JamDetect.h. Weights go into a logistic, a verdict needs JAM_TRIGGER_PROB
+
+#define JAM_TRIGGER_PROB 0.8f
+#define JAM_SHOT_RISE_MA 300.0f // Rev current jump over two samples that means a BB went through
+#define JAM_DRY_EMA 0.35f
+#define JAM_PADDLE_EMA 0.2f
+#define JAM_STALL_CAP 10.0f     // Paddle intervals overdue, more doesn't say anything new
+#define JAM_BIAS -6.0f
+#define JAM_W_STARVED 1.2f      // Per shot since the paddles last moved
+#define JAM_W_STALL 0.2f        // Per paddle interval overdue, only counts once a shot is starved
+#define JAM_W_DRY 3.0f
+#define CLUMP_BIAS -5.0f
+#define CLUMP_W_DRY 8.0f
+#define CLUMP_W_STARVED 1.0f
 
 #define CLUMP_CLEAR_VIBRATE_MS 500
+#define CLUMP_CLEAR_FEED_DUTY 0.8f
 #define CLUMP_CLEAR_COOLDOWN_MS 1000
 
 #define JAM_CLEAR_BACK_MS 130
@@ -28,7 +48,33 @@
 
 
 #define FEEDER_SENSE_ADC_THRESHOLD 2000 //We have to do analogReads on the feederSense pins, this is the threshold at which it should count as HIGH
-#define PADDLE_DETECT_DEBOUNCE_MS 30
+#define PADDLE_GLITCH_FILTER_NS 12000 // PCNT hardware filter, pulses shorter than this are ignored (max ~12.7us)
+#define PADDLE_MIN_INTERVAL_MS 30 // Contact bounce is ms long, the glitch filter can't see it. Paddles never come this close
+
+// Motor start scheduling, see MotorStart.h
+
+#define MOTOR_CURRENT_BUDGET_MA 12000.0f // What the battery can give before the bus sags too far
+#define MOTOR_MIN_BUS_MV 10800.0f        // Ramps hold below this
+#define MOTOR_START_HZ 200               // One step per PowerSampler reading
+#define MOTOR_RAMP_PER_S 8.0f            // Duty per second while ramping, 125ms to full
+#define MOTOR_STAGGER_MS 40              // Least time between two starts
+#define MOTOR_START_MAX_WAIT_MS 1000     // Start anyway after this, a motor that never starts is worse
+#define MOTOR_REV_INRUSH_MA 6000.0f      // Headroom a flywheel needs before it may start
+#define MOTOR_FEEDER_INRUSH_MA 1500.0f
+#define MOTOR_FEEDER_MA 800.0f           // The feeder motors aren't measured, assume this much at full duty
+#define MOTOR_FEEDER_AUX_MA 300.0f
+
+// Feeder rate control, see FeedControl.h
+
+#define FEED_PADDLE_HZ_PER_DUTY 25.0f // Paddles per second per wing at full duty, unloaded
+#define FEED_BB_MARGIN 1.3f           // Paddles per shot we aim for, a bit over so the path stays full
+#define FEED_PRIME_HZ 3.0f            // While revving without firing
+#define FEED_MIN_DUTY 0.15f           // Below this the motor doesn't turn
+#define FEED_CONTROL_WINDOW_MS 200
+#define FEED_RATE_EMA 0.5f
+#define FEED_KP 0.01f                 // Duty per paddle Hz of error
+#define FEED_KI 0.02f
+#define FEED_TRIM_MAX 0.25f           // Most the feedback may move the duty off the feed-forward
 
 // Motion core settings
 
@@ -48,24 +94,79 @@
 #define PITCH_OFFSET_L 0
 #define YAW_OFFSET_L 0
 
+// Servo motion profile limits, see Motion.h
+
+#define PITCH_MAX_VEL_R 400.0f // deg/s
+#define PITCH_MAX_ACC_R 4000.0f // deg/s^2
+#define YAW_MAX_VEL_R 400.0f
+#define YAW_MAX_ACC_R 4000.0f
+
+#define PITCH_MAX_VEL_L 400.0f
+#define PITCH_MAX_ACC_L 4000.0f
+#define YAW_MAX_VEL_L 400.0f
+#define YAW_MAX_ACC_L 4000.0f
+
+// Autonomous aim prediction, see AimFilter.h
+
+#define AIM_FILTER_ALPHA 0.5f
+#define AIM_FILTER_BETA 0.15f
+#define AIM_FILTER_TIMEOUT_MS 300 // No packet for this long means the target was lost
+#define AIM_FILTER_RESET_DEG 20.0f // Jumps bigger than this are a new target, not motion
+#define AIM_MAX_TARGET_VEL 180.0f // deg/s
+#define AIM_MAX_EXTRAPOLATE_MS 250
+#define AIM_HOST_LATENCY_MS 60 // Frame capture + inference on the autofire host, until it tells us otherwise
+
+// Control loop rates, driven by the hardware timer in Scheduler.cpp
+
+#define FIRE_LOOP_HZ 2000
+#define WING_LOOP_HZ 500
+#define FEED_LOOP_HZ 500
+#define REV_DETECT_HZ 200 // Only looks at the PowerSampler snapshot, no point outrunning POWER_SAMPLE_HZ
+#define LED_LOOP_HZ 50
+
 // Misc Settings
 
 #define MAX_TCP_CLIENTS 3
 
 // Pin definitions
 
-#define FEEDER_MOTOR_INDX 7
-#define FEEDER_AUX_INDX 6 
+// PCA9685 outputs are addressed as PWM_ADDR(board, channel), board n being pwmBoards[n] in Globals.cpp.
+// Another head goes on another board, nothing else needs to know which board a servo is on.
+// Build with -DPWM_BOARDS=2 for the left head on its own board (env:native_2boards runs the sim that way).
+
+#ifndef PWM_BOARDS
+#define PWM_BOARDS 1
+#endif
+#define PWM_BOARD_CHANNELS 16
+#define PWM_ADDR(board, ch) ((board) * PWM_BOARD_CHANNELS + (ch))
+#define PWM_BOARD(addr) ((addr) / PWM_BOARD_CHANNELS)
+#define PWM_CHANNEL(addr) ((addr) % PWM_BOARD_CHANNELS)
+
+#define FEEDER_BOARD 0
+#define HEAD_BOARD_R 0
+#if PWM_BOARDS > 1
+#define HEAD_BOARD_L 1
+#else
+#define HEAD_BOARD_L 0
+#endif
+
+#define FEEDER_MOTOR_INDX PWM_ADDR(FEEDER_BOARD, 7)
+#define FEEDER_AUX_INDX PWM_ADDR(FEEDER_BOARD, 6)
 
 #define FEEDER_SENSE_R 39
 #define FEEDER_SENSE_L 36
 
-#define REV_INDX_R 3
-#define REV_INDX_L 12
+#define REV_INDX_R PWM_ADDR(HEAD_BOARD_R, 3)
+#define REV_INDX_L PWM_ADDR(HEAD_BOARD_L, 12)
 
 #define FIRE_SOLENOID_PIN_R 18
 #define FIRE_SOLENOID_PIN_L 19
 
+// The INA226s get Wire1 to themselves, the PCA9685s keep Wire (21/22), so reading current on the app
+// core never holds the bus FlushPWM() needs on the control core
+#define POWER_I2C_SDA 4
+#define POWER_I2C_SCL 23
+
 //
 
 #define ENDSTOP_OPEN_R 14
@@ -75,14 +176,14 @@
 #define ENDSTOP_CLOSE_L 27
 
 
-#define EXPAND_SERVO_INDEX_R 0
-#define EXPAND_SERVO_INDEX_L 15
+#define EXPAND_SERVO_INDEX_R PWM_ADDR(HEAD_BOARD_R, 0)
+#define EXPAND_SERVO_INDEX_L PWM_ADDR(HEAD_BOARD_L, 15)
 
-#define PITCH_SERVO_INDEX_R 1
-#define PITCH_SERVO_INDEX_L 14
+#define PITCH_SERVO_INDEX_R PWM_ADDR(HEAD_BOARD_R, 1)
+#define PITCH_SERVO_INDEX_L PWM_ADDR(HEAD_BOARD_L, 14)
 
-#define YAW_SERVO_INDEX_R 2
-#define YAW_SERVO_INDEX_L 13
+#define YAW_SERVO_INDEX_R PWM_ADDR(HEAD_BOARD_R, 2)
+#define YAW_SERVO_INDEX_L PWM_ADDR(HEAD_BOARD_L, 13)
 
 //
 
@@ -106,5 +207,6 @@
     enum TurretM {Autonomous, GloveManual, Default};
     enum FireMode {Auto = 0, Burst = 1, Single = 2};
     enum FireRate {Fast = 0, Medium = 1, Slow = 2};
+    enum VolleyPattern {Alternate = 0, Simultaneous = 1, Staggered = 2};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "PowerSampler.h"
+#include <atomic>
+#include <INA226.h>
+#include <Wire.h>
+#include "Control.h"
+
+extern INA226 currSens[];
+
+// Two buffers, the one at powerSeq & 1 is the published one and the writer only ever fills the
+// other. As soon as a sample is published the next one starts filling the buffer that was published
+// before it, which a slow reader may still be copying, so a reader that sees powerSeq move at all
+// while it copied has to copy again.
+PowerSnapshot powerBuf[2] = {};
+std::atomic<uint32_t> powerSeq(0);
+
+PowerWing powerAcc[WINGS] = {};  // Sampler side running stats
+float powerWindowPeakMA[WINGS] = {};
+float powerWindowJ[WINGS] = {};
+uint32_t powerWindowStartMs = 0;
+uint32_t powerLastUs = 0;
+volatile bool powerResetPending = false;
+
+void PowerSample(){
+    uint32_t seq = powerSeq.load(std::memory_order_relaxed);
+    PowerSnapshot &snap = powerBuf[(seq + 1) & 1];
+    uint32_t now = micros();
+    float dt = powerLastUs ? (now - powerLastUs) / 1000000.0f : 0.0f;
+    powerLastUs = now;
+
+    if(powerResetPending){
+        powerResetPending = false;
+        for(uint8_t i = 0; i < WINGS; i++){
+            powerAcc[i].energyJ = 0.0f;
+            powerAcc[i].maxPeakMA = 0.0f;
+        }
+    }
+
+    bool windowDone = millis() - powerWindowStartMs >= POWER_WINDOW_MS;
+
+    for(uint8_t i = 0; i < WINGS; i++){
+        PowerWing &a = powerAcc[i];
+
+        a.busV = currSens[i].getBusVoltage();
+        a.currentMA = currSens[i].getCurrent_mA();
+        a.powerMW = a.busV * a.currentMA;
+        a.energyJ += a.powerMW / 1000.0f * dt;
+        if(a.currentMA > a.maxPeakMA)
+            a.maxPeakMA = a.currentMA;
+
+        if(a.currentMA > powerWindowPeakMA[i])
+            powerWindowPeakMA[i] = a.currentMA;
+        powerWindowJ[i] += a.powerMW / 1000.0f * dt;
+
+        if(windowDone){
+            a.peakMA = powerWindowPeakMA[i];
+            a.windowJ = powerWindowJ[i];
+            powerWindowPeakMA[i] = 0.0f;
+            powerWindowJ[i] = 0.0f;
+        }
+
+        snap.wing[i] = a;
+    }
+
+    if(windowDone)
+        powerWindowStartMs = millis();
+
+    snap.sample = seq + 1;
+    snap.us = now;
+    powerSeq.store(seq + 1, std::memory_order_release);
+}
+
+void PowerRead(PowerSnapshot &out){
+    for(;;){
+        uint32_t seq = powerSeq.load(std::memory_order_acquire);
+        out = powerBuf[seq & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(powerSeq.load(std::memory_order_relaxed) == seq)
+            return;
+    }
+}
+
+void PowerResetStats(){
+    powerResetPending = true; // Done by the sampler, it owns the accumulators
+}
+
+void PowerPrintStats(){
+    PowerSnapshot p;
+    PowerRead(p);
+
+    for(uint8_t i = 0; i < WINGS; i++){
+        PowerWing &w = p.wing[i];
+        Serial.printf("Power %u %5.2fV %7.1fmA %7.0fmW window peak: %7.1fmA %6.2fJ total: %8.1fJ peak: %7.1fmA\n",
+                      i, w.busV, w.currentMA, w.powerMW, w.peakMA, w.windowJ, w.energyJ, w.maxPeakMA);
+    }
+}
+
+static void PowerTask(void *){
+    TickType_t wake = xTaskGetTickCount();
+
+    for(;;){
+        PowerSample();
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / POWER_SAMPLE_HZ));
+    }
+}
+
+void InitPowerSampler(){
+    Wire1.begin(POWER_I2C_SDA, POWER_I2C_SCL);
+
+    for(uint8_t i = 0; i < WINGS; i++){
+        if(!currSens[i].begin())
+            Serial.println("Failed to init current sensor " + String(i));
+
+        currSens[i].setMaxCurrentShunt(POWER_MAX_CURRENT_A, POWER_SHUNT_OHM);
+        currSens[i].setAverage(INA226_4_SAMPLES);
+        currSens[i].setBusVoltageConversionTime(INA226_588_us);
+        currSens[i].setShuntVoltageConversionTime(INA226_588_us);
+        currSens[i].setModeShuntBusContinuous();
+    }
+
+    xTaskCreatePinnedToCore(PowerTask, "Power", 3072, NULL, POWER_TASK_PRIO, NULL, APP_CORE);
+}
@@ -0,0 +1,40 @@
+#ifndef POWER_SAMPLER_H
+#define POWER_SAMPLER_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Both INA226s run in continuous shunt+bus conversion with hardware averaging, and a low priority
+// task on the app core reads them at POWER_SAMPLE_HZ. Results go into a double-buffered snapshot,
+// so the control loop never waits on I2C to know the rev current, it just copies the latest one.
+// They sit on Wire1, so these reads never hold up the PWM flush on Wire either.
+
+#define POWER_SAMPLE_HZ 200      // Matches the INA226 output rate below (4 x (588us + 588us) = 4.7ms)
+#define POWER_TASK_PRIO 3
+#define POWER_WINDOW_MS 1000     // Rolling peak/energy window
+#define POWER_SHUNT_OHM 0.01f
+#define POWER_MAX_CURRENT_A 8.0f  // Sets the current LSB, the register saturates here (81.92mV full scale on the shunt)
+
+struct PowerWing {
+    float busV;
+    float currentMA;
+    float powerMW;
+    float peakMA;        // Highest current in the last full window
+    float windowJ;       // Energy used in the last full window
+    float energyJ;       // Since boot or the last PowerResetStats()
+    float maxPeakMA;     // Since boot or the last PowerResetStats()
+};
+
+struct PowerSnapshot {
+    uint32_t sample;     // Increments on every new reading, 0 = none yet
+    uint32_t us;
+    PowerWing wing[WINGS];
+};
+
+void InitPowerSampler();
+void PowerSample();
+void PowerRead(PowerSnapshot &out);
+void PowerResetStats();
+void PowerPrintStats();
+
+#endif
@@ -0,0 +1,81 @@
+#include "Profiler.h"
+
+ProfSection profSections[PROF_SECTIONS] = {};
+volatile uint32_t profGen = 0; // Only ProfReset() writes it
+
+const char *profNames[PROF_SECTIONS] = {"tick", "wing", "fire", "feed", "state", "status", "rev", "server", "leds", "telem", "motors"};
+
+static uint8_t BucketFor(uint32_t cycles){
+    if(cycles < (1UL << PROF_MIN_BITS))
+        return 0;
+
+    uint8_t bits = 31 - __builtin_clz(cycles); // Power of two below cycles
+    if(bits >= PROF_MAX_BITS)
+        return PROF_BUCKETS - 1;
+
+    uint8_t sub = (cycles >> (bits - 2)) & (PROF_SUB_BUCKETS - 1); // Next two bits after the leading one
+    return (bits - PROF_MIN_BITS) * PROF_SUB_BUCKETS + sub;
+}
+
+static uint32_t BucketTop(uint8_t bucket){ // Largest cycle count that still falls into the bucket
+    uint8_t bits = bucket / PROF_SUB_BUCKETS + PROF_MIN_BITS;
+    uint8_t sub = bucket % PROF_SUB_BUCKETS;
+    return (1UL << bits) + ((sub + 1) << (bits - 2)) - 1;
+}
+
+void ProfEnd(ProfId id, uint32_t start){
+    uint32_t cycles = ESP.getCycleCount() - start;
+    ProfSection &s = profSections[id];
+
+    uint32_t gen = profGen;
+    if(s.gen != gen){ // Reset since this section last ran
+        s = {};
+        s.gen = gen;
+    }
+
+    if(s.count == 0 || cycles < s.minCycles)
+        s.minCycles = cycles;
+    if(cycles > s.maxCycles)
+        s.maxCycles = cycles;
+
+    s.count++;
+    s.totalCycles += cycles;
+    s.hist[BucketFor(cycles)]++;
+}
+
+void ProfReset(){
+    profGen++;
+}
+
+static uint32_t Percentile(const ProfSection &s, uint8_t pct){
+    uint32_t want = ((uint64_t) s.count * pct + 99) / 100;
+    uint32_t seen = 0;
+
+    for(uint8_t b = 0; b < PROF_BUCKETS; b++){
+        seen += s.hist[b];
+        if(seen >= want)
+            return min(BucketTop(b), s.maxCycles);
+    }
+    return s.maxCycles;
+}
+
+size_t ProfFormat(char *buf, size_t len){
+    float mhz = ESP.getCpuFreqMHz();
+    size_t n = snprintf(buf, len, "%-7s %9s %8s %8s %8s %8s\n", "us", "count", "min", "avg", "p99", "max");
+
+    for(uint8_t i = 0; i < PROF_SECTIONS && n < len; i++){
+        ProfSection s = profSections[i]; // Copy, the other core may be writing it
+        if(!s.count || s.gen != profGen) // Nothing since the last reset
+            continue;
+
+        n += snprintf(buf + n, len - n, "%-7s %9lu %8.1f %8.1f %8.1f %8.1f\n", profNames[i], (unsigned long) s.count,
+                      s.minCycles / mhz, s.totalCycles / (float) s.count / mhz, Percentile(s, 99) / mhz, s.maxCycles / mhz);
+    }
+    return min(n, len);
+}
+
+void ProfPrint(){
+    char buf[PROF_SECTIONS * 64 + 64];
+    ProfFormat(buf, sizeof(buf));
+    Serial.print(buf);
+}
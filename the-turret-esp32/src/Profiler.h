@@ -0,0 +1,37 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Cycle counter profiler for the main loop stages. Each section keeps min/avg/max plus a log
+// histogram (PROF_SUB_BUCKETS per power of two) to read percentiles from. Fixed size, no
+// allocations, so it can stay on in the control path. A section must always be timed from the
+// same core, the cycle counters of the two cores aren't synchronized. For the same reason only
+// that core clears a section: ProfReset() moves profGen on and the next ProfEnd() starts it over.
+
+#define PROF_SUB_BUCKETS 4
+#define PROF_MIN_BITS 6   // Everything under 64 cycles lands in the first bucket
+#define PROF_MAX_BITS 28  // ~1.1s at 240MHz, everything above lands in the last one
+#define PROF_BUCKETS ((PROF_MAX_BITS - PROF_MIN_BITS) * PROF_SUB_BUCKETS)
+
+enum ProfId : uint8_t {ProfTick, ProfWing, ProfFire, ProfFeed, ProfState, ProfStatus, ProfRev, ProfServer, ProfLeds, ProfTelemetry, ProfMotors, PROF_SECTIONS};
+
+struct ProfSection {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t hist[PROF_BUCKETS];
+    uint32_t gen;    // profGen it was last cleared at
+};
+
+inline uint32_t ProfStart(){
+    return ESP.getCycleCount();
+}
+
+void ProfEnd(ProfId id, uint32_t start);
+void ProfReset();
+size_t ProfFormat(char *buf, size_t len); // Text table, returns chars written
+void ProfPrint();
+
+#endif
@@ -0,0 +1,75 @@
+#include "RevDetect.h"
+#include "Telemetry.h"
+#include "PowerSampler.h"
+
+RevDetector revDetect[WINGS] = {};
+uint32_t revLastSample = 0;
+
+void RevDetectStart(uint8_t wing){
+    RevDetector &d = revDetect[wing];
+
+    d.active = true;
+    d.ready = false;
+    d.startMs = millis();
+    d.currentMA = 0.0f;
+    d.peakMA = 0.0f;
+    d.busMV = d.restMV;
+    d.settled = 0;
+}
+
+void RevDetectStop(uint8_t wing){
+    revDetect[wing].active = false;
+}
+
+bool RevReady(uint8_t wing){
+    return revDetect[wing].active && revDetect[wing].ready;
+}
+
+void RevDetectLoop(){
+    PowerSnapshot power;
+    PowerRead(power);
+
+    if(power.sample == revLastSample) // Nothing new from the sampler
+        return;
+    revLastSample = power.sample;
+
+    for(uint8_t i = 0; i < WINGS; i++){
+        RevDetector &d = revDetect[i];
+        float mv = power.wing[i].busV * 1000.0f;
+
+        if(!d.active){ // Keep track of the unloaded bus voltage
+            d.restMV = d.restMV ? d.restMV + (mv - d.restMV) * REV_DETECT_EMA : mv;
+            continue;
+        }
+
+        if(d.ready)
+            continue;
+
+        d.currentMA += (power.wing[i].currentMA - d.currentMA) * REV_DETECT_EMA;
+        d.busMV += (mv - d.busMV) * REV_DETECT_EMA;
+        if(d.currentMA > d.peakMA)
+            d.peakMA = d.currentMA;
+
+        uint32_t elapsed = millis() - d.startMs;
+
+        if(elapsed >= FIRE_REV_MS){
+            d.ready = true;
+            d.spinUpMs = 0;
+            TelemLogEvent(EvRevTimeout, i);
+            continue;
+        }
+
+        if(elapsed >= REV_DETECT_MIN_MS && d.peakMA >= REV_INRUSH_MIN_MA &&
+           d.currentMA <= d.peakMA * REV_SETTLE_FRAC && d.restMV - d.busMV <= REV_SAG_READY_MV){
+            d.settled++;
+        }else{
+            d.settled = 0;
+        }
+
+        if(d.settled >= REV_SETTLE_SAMPLES){
+            d.ready = true;
+            d.spinUpMs = elapsed;
+            TelemLogEvent(EvRevReady, i | (elapsed << 8));
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef REV_DETECT_H
+#define REV_DETECT_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Decides when each flywheel is up to speed from its INA226 instead of always waiting FIRE_REV_MS.
+// A brushed motor draws a big inrush that falls off as back-EMF builds, and the bus sags and
+// recovers with it, so the wheel counts as spun up once the current has dropped to a fraction of
+// its peak and the bus voltage is back near where it was before rev. If the sensor never sees an
+// inrush (disconnected, dead) we fall back to FIRE_REV_MS.
+
+struct RevDetector {
+    bool active;
+    bool ready;
+    uint32_t startMs;
+    uint32_t spinUpMs;  // How long the last spin up took, 0 if it fell back to the timeout
+    float currentMA;    // Smoothed
+    float peakMA;
+    float busMV;
+    float restMV;       // Bus voltage while the motor is off
+    uint8_t settled;    // Consecutive samples that looked settled
+};
+
+void RevDetectStart(uint8_t wing);
+void RevDetectStop(uint8_t wing);
+bool RevReady(uint8_t wing);
+void RevDetectLoop();
+
+#endif
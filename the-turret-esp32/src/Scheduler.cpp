@@ -0,0 +1,121 @@
+#include "Scheduler.h"
+#include <esp_timer.h>
+
+SchedTask schedTasks[SCHED_MAX_TASKS] = {};
+uint8_t schedTaskCount = 0;
+
+static hw_timer_t *schedTimer = NULL;
+static TaskHandle_t schedTaskHandle = NULL;
+
+volatile uint32_t schedTicks = 0;
+uint32_t schedSeenTicks = 0;
+uint32_t schedMissedTicks = 0; // Ticks that came and went while we were still busy with an earlier one
+volatile bool schedResetPending = false;
+
+static void IRAM_ATTR OnSchedTick(){
+    schedTicks++;
+    SchedulerNotifyFromISR(SCHED_NOTIFY_TICK);
+}
+
+void IRAM_ATTR SchedulerNotifyFromISR(uint32_t bits){
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(schedTaskHandle, bits, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void InitScheduler(){
+    schedTaskHandle = xTaskGetCurrentTaskHandle(); // Whoever calls this is the one that gets woken up
+
+    uint64_t first = esp_timer_get_time() + SCHED_TICK_US; // The first alarm is a whole tick away
+    for(uint8_t i = 0; i < schedTaskCount; i++)
+        schedTasks[i].nextUs = first;
+
+    schedTimer = timerBegin(1000000); // 1MHz, so the alarm is in us
+    timerAttachInterrupt(schedTimer, &OnSchedTick);
+    timerAlarm(schedTimer, SCHED_TICK_US, true, 0);
+}
+
+void SchedulerAdd(const char *name, void (*fn)(), uint32_t hz, ProfId prof){
+    if(schedTaskCount >= SCHED_MAX_TASKS){
+        Serial.println("Scheduler full, dropping " + String(name));
+        return;
+    }
+
+    SchedTask &t = schedTasks[schedTaskCount++];
+    t.name = name;
+    t.fn = fn;
+    t.prof = prof;
+    t.periodUs = 1000000UL / hz;
+    if(t.periodUs < SCHED_TICK_US)
+        t.periodUs = SCHED_TICK_US;
+    t.nextUs = esp_timer_get_time();
+}
+
+uint32_t SchedulerWait(){
+    uint32_t bits = 0;
+    if(xTaskNotifyWait(0, 0xffffffff, &bits, pdMS_TO_TICKS(10)) != pdTRUE)
+        return 0;
+
+    if(bits & SCHED_NOTIFY_TICK){
+        uint32_t ticks = schedTicks;
+        if(schedSeenTicks && ticks - schedSeenTicks > 1)
+            schedMissedTicks += ticks - schedSeenTicks - 1;
+        schedSeenTicks = ticks;
+    }
+    return bits;
+}
+
+void SchedulerRun(uint64_t nowUs){
+    if(schedResetPending){
+        schedResetPending = false;
+        for(uint8_t i = 0; i < schedTaskCount; i++){
+            schedTasks[i].runs = 0;
+            schedTasks[i].overruns = 0;
+            schedTasks[i].maxJitterUs = 0;
+            schedTasks[i].maxRunUs = 0;
+        }
+        schedMissedTicks = 0;
+    }
+
+    for(uint8_t i = 0; i < schedTaskCount; i++){
+        SchedTask &t = schedTasks[i];
+        if(nowUs < t.nextUs)
+            continue;
+
+        uint64_t start = esp_timer_get_time();
+        uint32_t jitter = start - t.nextUs;
+
+        uint32_t cycles = ProfStart();
+        t.fn();
+        ProfEnd(t.prof, cycles);
+
+        uint32_t run = esp_timer_get_time() - start;
+        t.runs++;
+        if(jitter > t.maxJitterUs)
+            t.maxJitterUs = jitter;
+        if(run > t.maxRunUs)
+            t.maxRunUs = run;
+
+        if(jitter >= t.periodUs || run > t.periodUs)
+            t.overruns++;
+
+        t.nextUs += t.periodUs;
+        if(t.nextUs <= start) // Fell a whole period behind, skip the missed slots instead of bursting to catch up
+            t.nextUs = start + t.periodUs - ((start - t.nextUs) % t.periodUs);
+    }
+}
+
+void SchedulerResetStats(){
+    schedResetPending = true; // Done by SchedulerRun(), the control task owns the stats
+}
+
+void SchedulerPrintStats(){
+    Serial.printf("Ticks: %lu missed: %lu\n", (unsigned long) schedTicks, (unsigned long) schedMissedTicks);
+
+    for(uint8_t i = 0; i < schedTaskCount; i++){
+        SchedTask &t = schedTasks[i];
+        Serial.printf("%-8s %5luHz runs: %8lu overruns: %5lu jitter max: %5luus run max: %5luus\n",
+                      t.name, 1000000UL / t.periodUs, (unsigned long) t.runs, (unsigned long) t.overruns,
+                      (unsigned long) t.maxJitterUs, (unsigned long) t.maxRunUs);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "Profiler.h"
+
+// Fixed-rate scheduler driven by a hardware timer. Every SCHED_TICK_US the timer ISR wakes the
+// scheduler task, which then runs whatever loops are due and records how late they started.
+// Everything is on the 64-bit esp_timer clock, micros() wraps after 71.6 minutes.
+
+#define SCHED_TICK_US 500 // 2kHz base tick, every task period must be a multiple of this
+#define SCHED_MAX_TASKS 8
+
+// Task notification bits the scheduler task can be woken with. Bits above the tick are free for
+// other ISRs that need the control task to react before the next tick (see SchedulerNotifyFromISR).
+#define SCHED_NOTIFY_TICK (1 << 0)
+
+struct SchedTask {
+    const char *name;
+    void (*fn)();
+    uint32_t periodUs;
+    ProfId prof;
+
+    uint64_t nextUs;      // When this task should have started
+    uint32_t runs;
+    uint32_t overruns;    // Started a whole period late, or ran longer than its period
+    uint32_t maxJitterUs; // Worst start delay versus nextUs
+    uint32_t maxRunUs;
+};
+
+void InitScheduler();
+void SchedulerAdd(const char *name, void (*fn)(), uint32_t hz, ProfId prof);
+uint32_t SchedulerWait(); // Blocks until the next tick or another notification, returns the SCHED_NOTIFY_* bits
+void SchedulerNotifyFromISR(uint32_t bits);
+void SchedulerRun(uint64_t nowUs);
+void SchedulerResetStats();
+void SchedulerPrintStats();
+
+#endif
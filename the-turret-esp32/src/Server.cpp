@@ -1,246 +1,517 @@
 #include "Server.h"
 #include "PinsAndDefs.h"
 #include "Audio.h"
+#include "Control.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "SpscQueue.h"
+#include "Latency.h"
 
 #include "radio.h"
 #include "i_dont_hate_you.h"
 
 extern ROMBackgroundAudioWAV audio;
 
-extern float pitch;
-extern float yaw;
-
-extern bool fire;
-extern bool doRev;
-extern bool safety;
-extern uint16_t burstCount;
 extern uint16_t fireDelays[];
 
 uint64_t feedBackMillis = 0;
 
-extern WingState targetWingStates[];
-
 extern TurretM turretMode;
 extern FireMode fireMode;
 extern FireRate fireRate;
 
-WiFiUDP udp;
+AsyncUDP udp;
+
+// Datagrams are decoded in AsyncUDP's callback, on the lwIP task, into fixed-size NetRecords that
+// ServerLoop() takes off netRx, so the app side never touches the socket. The callback may only
+// touch netRx and its own counters, not the control queue or telemetry.
+#define NET_RX_QUEUE_LEN 32
+#define NET_TEXT_MAX 48
+
+enum NetKind : uint8_t {NetFrame, NetText};
+
+struct NetRecord {
+  NetKind kind;
+  uint8_t len;        // NetText, bytes in text
+  uint8_t argStart;   // NetText, where the verb's argument or the intent's slot starts in text
+  uint8_t argLen;
+  TextHandler fn;     // NetText, already looked up, NULL if it isn't a command we know
+  uint32_t us;        // micros() when it came in
+  IPAddress ip;
+  uint16_t port;
+  union {
+    TpFrame frame;
+    char text[NET_TEXT_MAX];
+  };
+};
+
+SpscQueue<NetRecord, NET_RX_QUEUE_LEN> netRx;
+IPAddress netRemoteIP;    // Sender of the record being handled, for replies
+uint16_t netRemotePort = 0;
+
+// Binary frames, see TurretProtocol.h
+#define TP_SEQ_RESTART 1000 // Jumping back more than this is the sender restarting, not reordering
+
+uint16_t tpLastSeq[TP_OPCODES] = {};
+bool tpSeqValid[TP_OPCODES] = {};
+uint32_t tpFrames = 0;
+uint32_t tpBadFrames = 0;   // Wrong size, version or opcode
+uint32_t tpStaleFrames = 0; // Aim frames older than one we already used
+uint32_t textCommands = 0;
+
+// Every pending datagram is read on each pass. An aim update only replaces the one waiting, anything
+// else sends the waiting aim first, so aim and commands still reach the control task in order.
+#define SERVER_MAX_DRAIN 32 // Most datagrams per pass, so a flood can't starve the rest of AppLoop
+
+struct PendingAim {
+  bool valid;
+  ControlCmdType type; // CmdAim or CmdTrack
+  float pitch;
+  float yaw;
+  LatencyTag lat;      // Of the datagram it came in
+};
+
+PendingAim pendingAim = {};
+uint16_t udpDepth = 0;       // Datagrams read on the last pass that had any
+uint16_t udpMaxDepth = 0;
+uint32_t udpPackets = 0;
+uint32_t aimCoalesced = 0;   // Aim updates replaced by a newer one before being sent
+uint32_t udpDrainCapped = 0; // Passes that stopped at SERVER_MAX_DRAIN
+
+static void DispatchText(TextHandler fn, std::string_view arg);
+
+static void QueueAim(ControlCmdType type, float pitch, float yaw){
+  if(pendingAim.valid)
+    aimCoalesced++;
+  pendingAim = {true, type, pitch, yaw, controlTag};
+}
+
+static void FlushAim(){
+  if(!pendingAim.valid)
+    return;
+  LatencyTag tag = controlTag; // Can be flushed while handling a later datagram
+  controlTag = pendingAim.lat;
+  SendControl(pendingAim.type, 0, pendingAim.pitch, pendingAim.yaw);
+  controlTag = tag;
+  pendingAim.valid = false;
+}
+
+void SetWings(WingState target){
+  SendControl(CmdWings, target);
+}
+
+// Stats reply: the profiler table, then the udp line and one line per latency kind, which get
+// STATS_TAIL_LEN kept back for them however long the table gets
+#define STATS_TAIL_LEN 320
+
+// What a formatter wrote, without the terminator and never past the end of buf
+static size_t StatsAdvance(size_t len, int n, size_t size){
+  return len + min((size_t) max(n, 0), size - 1 - len);
+}
+
+void ReplyStats(){
+  char buf[PROF_SECTIONS * 64 + 64 + STATS_TAIL_LEN];
+  size_t len = StatsAdvance(0, ProfFormat(buf, sizeof(buf) - STATS_TAIL_LEN), sizeof(buf) - STATS_TAIL_LEN);
+  len = StatsAdvance(len, snprintf(buf + len, sizeof(buf) - len, "udp %lu depth %u max %u coalesced %lu capped %lu dropped %lu\n",
+                                   (unsigned long) udpPackets, udpDepth, udpMaxDepth, (unsigned long) aimCoalesced,
+                                   (unsigned long) udpDrainCapped, (unsigned long) netRx.Dropped()), sizeof(buf));
+  len = StatsAdvance(len, LatencyFormat(buf + len, sizeof(buf) - len), sizeof(buf));
+
+  udp.writeTo((uint8_t*) buf, len, netRemoteIP, netRemotePort);
+}
+
+// lwIP task
+static void OnPacket(AsyncUDPPacket &packet){
+  NetRecord rec;
+  rec.us = micros();
+  rec.ip = packet.remoteIP();
+  rec.port = packet.remotePort();
+
+  const uint8_t *data = packet.data();
+  size_t len = packet.length();
+
+  if(TpIsFrame(data, len)){
+    const TpFrame *frame = TpDecode(data, len);
+    if(!frame){
+      tpBadFrames++;
+      return;
+    }
+    rec.kind = NetFrame;
+    rec.frame = *frame;
+  }else{
+    len = min(len, (size_t) NET_TEXT_MAX - 1);
+    memcpy(rec.text, data, len);
+    rec.text[len] = 0;
+
+    std::string_view arg;
+    rec.kind = NetText;
+    rec.len = len;
+    rec.fn = FindTextCommand(std::string_view(rec.text, len), arg);
+    rec.argStart = arg.empty() ? 0 : arg.data() - rec.text;
+    rec.argLen = arg.size();
+  }
+
+  netRx.Push(rec); // Full counts as dropped
+}
 
 void InitServer(){
-    udp.begin(21);
+  if(udp.listen(TP_PORT))
+    udp.onPacket(OnPacket);
 }
 
 void ServerLoop(){
-  const uint8_t buffSize = 50;
-  uint8_t buff[buffSize];
-
-  if(udp.parsePacket()){
-    uint32_t len = udp.read(buff, buffSize-1);
-    buff[len] = 0;
-    
-    ParseCommand(String((char*) buff));
+  NetRecord rec;
+
+  uint16_t depth = 0;
+  while(depth < SERVER_MAX_DRAIN && netRx.Pop(rec)){
+    depth++;
+    netRemoteIP = rec.ip;
+    netRemotePort = rec.port;
+
+    if(rec.kind == NetFrame){
+      controlTag = LatencyTagFrame(rec.frame, rec.us, rec.ip, rec.port);
+      ParseFrame(rec.frame);
+      controlTag = {};
+      continue;
+    }
+
+    textCommands++;
+    TelemLogText(rec.text);
+    controlTag = {rec.us, 0}; // Measured too, text has nothing to ack with
+    if(rec.fn)
+      DispatchText(rec.fn, std::string_view(rec.text + rec.argStart, rec.argLen));
+    controlTag = {};
+  }
+  FlushAim();
+
+  TpAckFrame ack;
+  IPAddress ip;
+  uint16_t port;
+  while(LatencyNextAck(ack, ip, port))
+    udp.writeTo((uint8_t*) &ack, sizeof(ack), ip, port);
+
+  if(depth){
+    udpPackets += depth;
+    udpDepth = depth;
+    udpMaxDepth = max(udpMaxDepth, depth);
+    udpDrainCapped += depth == SERVER_MAX_DRAIN;
   }
 }
 
-void ParseCommand(const String& msg){
-  Serial.println(msg);
-
-  IntentAndSlot res = ParseIntent(msg);
-  
-  if(res.intent.length()>0)
-    Serial.println("Intent: " + res.intent);
-  if(res.slot.length()>0)
-    Serial.println("Slot: " + res.slot);
-
-  if(res.intent.length()){
-    if(res.intent.startsWith("maintenance")){
-      turretMode = Default;
-
-      pitch = 0.0f;
-      yaw = 0.0f;
-
-      if(targetWingStates[0] == Closed){
-        targetWingStates[0] = Open;
-        targetWingStates[1] = Open;
-      }else{
-        targetWingStates[0] = Closed;
-        targetWingStates[1] = Closed;
-      }
-
-    }else if(res.intent.startsWith("sing")){
-        if(res.slot.length() > 0){
-          if(res.slot.startsWith("portal radio music")){
-            PlayAudio(radio_wav, radio_wav_len);
-            Serial.println("Radio");
-
-          }else if(res.slot.startsWith("turret opera")){
-            //PlayAudio(portal_opera_wav, portal_opera_wav_len);
-            Serial.println("Radio");
-          }
-        }
-    }else if(res.intent.startsWith("rateoffire")){
-      if(res.slot.startsWith("slow")){
-        fireRate = Slow;
-
-      }else if(res.slot.startsWith("medium")){
-        fireRate = Medium;
-
-      }else if(res.slot.startsWith("fast")){
-        fireRate = Fast;
-      }
-      Serial.println("Set firerate to: " + String(fireRate));
-
-    }else if(res.intent.startsWith("safety")){
-      if(res.slot.startsWith("on")){
-        safety = true;
-      }else if(res.slot.startsWith("off")){
-        safety = false;
-      }
-      Serial.println("Safety " + safety ? "on" : "off");
-    
-    }else if(res.intent.startsWith("feedback")){
-      feedBackMillis = millis();
-    }else if(res.intent.startsWith("cakeisalie")){
-      PlayAudio(i_dont_hate_you_wav, i_dont_hate_you_wav_len);
-      Serial.println("hate");
-    
-    }else if(res.intent.startsWith("returnauto")){
-      turretMode = Autonomous;
-      targetWingStates[0] = Closed;
-      targetWingStates[1] = Closed;
-      fire = false;
-      doRev = false;
-
-    }else if(res.intent.startsWith("controlovr")){
-        turretMode = GloveManual;
-        fire = false;
-        doRev = false;
-        targetWingStates[0] = Open;
-        targetWingStates[1] = Open;
-
-    }else if(res.intent.startsWith("openstatus")){
-      if(res.slot.startsWith("deploy")){
-        targetWingStates[0] = Open;
-        targetWingStates[1] = Open;
-
-      }else if(res.slot.startsWith("retract")){
-        targetWingStates[0] = Closed;
-        targetWingStates[1] = Closed;
-      }
-    }else if(res.intent.startsWith("mode")){
-        Serial.println("Firemode");
-
-        if(res.slot.startsWith("auto")){
-            fireMode = Auto;
-            Serial.println("Firemode to full");
-        }else if(res.slot.startsWith("single")){
-            fireMode = Single;
-            Serial.println("Firemode to single");
-        }else if(res.slot.startsWith("burst")){
-            fireMode = Burst;
-            Serial.println("Firemode to burst");
-        }
-    }
+void ParseFrame(const TpFrame& f){
+  tpFrames++;
+
+  if((f.flags & TP_FLAG_AUTONOMOUS) && turretMode != Autonomous){
+    return;
+  }
 
-  }else{ // NOT a intent-slot command
-    if(msg.startsWith("P") && turretMode == GloveManual){
-      String pSubstr = msg.substring(1, msg.indexOf('Y'));
-      String ySubstr = msg.substring(msg.indexOf('Y') + 1);
-      pitch = pSubstr.toFloat();
-      yaw = ySubstr.toFloat();
-    }else if(msg.startsWith("B")){
-      burstCount = msg.substring(1).toInt();
-      
-    }else if(msg.startsWith("open")){
-      targetWingStates[0] = Open;
-      targetWingStates[1] = Open;
-      
-    }else if(msg == "close"){
-      targetWingStates[0] = Closed;
-      targetWingStates[1] = Closed;
-
-    }else if(msg.startsWith("Aopen") && turretMode == Autonomous){
-      targetWingStates[0] = Open;
-      targetWingStates[1] = Open;
-      
-    }else if(msg == "Aclose" && turretMode == Autonomous){
-      targetWingStates[0] = Closed;
-      targetWingStates[1] = Closed;
-
-    }else if(msg.startsWith("ArevOn") && turretMode == Autonomous){
-      doRev = true;
-
-    }else if(msg.startsWith("ArevOff") && turretMode == Autonomous){
-      doRev = false;
-
-    }else if(msg.startsWith("AfireOn") && turretMode == Autonomous){
-      fire = true;
-
-    }else if(msg.startsWith("AfireOff") && turretMode == Autonomous){
-      fire = false;
-
-    }else if(msg.startsWith("voiceline_found")){
-      //TargetFoundVoiceline(); Commented: speaker makes the voicelines sad, plus it's crashing for some reason
-
-    }else if(msg.startsWith("revOn")){
-      doRev = true;
-
-    }else if(msg.startsWith("revOff")){
-      doRev = false;
-
-    }else if(msg.startsWith("fireOn")){
-      fire = true;
-
-    }else if(msg.startsWith("fireOff")){
-      fire = false;
-
-    }else if(msg.startsWith("AP") && turretMode == Autonomous){
-      String pSubstr = msg.substring(2, msg.indexOf('Y'));
-      String ySubstr = msg.substring(msg.indexOf('Y') + 1);
-      pitch = pSubstr.toFloat();
-      yaw = ySubstr.toFloat();
+  if(f.opcode == TpAim || f.opcode == TpTrack){ // Only aim cares about order, a late one would yank the servos back
+    int16_t ahead = f.seq - tpLastSeq[f.opcode];
+    if(tpSeqValid[f.opcode] && ahead <= 0 && ahead > -TP_SEQ_RESTART){
+      tpStaleFrames++;
+      return;
     }
+    tpLastSeq[f.opcode] = f.seq;
+    tpSeqValid[f.opcode] = true;
   }
 
-  /*if(msg.startsWith("open")){
-    targetWingStates[0] = Open;
-    targetWingStates[1] = Open;
-  }else if(msg == "close"){
-    targetWingStates[0] = Closed;
-    targetWingStates[1] = Closed;
-  }else if(msg == "revOn"){
-    doRev = true;
-  }else if(msg == "revOff"){
-    doRev = false;
-  }else if(msg == "fireOn"){
-    fire = true;
-  }else if(msg == "fireOff"){
-    fire = false;
-  }else if(msg.startsWith("P")){
-    String pSubstr = msg.substring(1, msg.indexOf('Y'));
-    String ySubstr = msg.substring(msg.indexOf('Y') + 1);
-    pitch = pSubstr.toFloat();
-    yaw = ySubstr.toFloat();
+  bool on = f.flags & TP_FLAG_ON;
+
+  if(f.opcode != TpAim && f.opcode != TpTrack)
+    FlushAim();
+
+  switch(f.opcode){
+    case TpAim:
+      if(turretMode == GloveManual)
+        QueueAim(CmdAim, f.pitchCd / 100.0f, f.yawCd / 100.0f);
+      break;
+    case TpTrack:
+      if(turretMode == Autonomous)
+        QueueAim(CmdTrack, f.pitchCd / 100.0f, f.yawCd / 100.0f);
+      break;
+    case TpAimLatency:
+      SendControl(CmdAimLatency, f.value);
+      break;
+    case TpRev:
+      SendControl(CmdRev, on);
+      break;
+    case TpFire:
+      SendControl(CmdFire, on);
+      break;
+    case TpWings:
+      SetWings(on ? Open : Closed);
+      break;
+    case TpBurst:
+      SendControl(CmdBurst, f.value);
+      break;
+    case TpVolley:
+      SendControl(CmdVolley, f.value & 0xFF, f.value >> 8);
+      TelemLogEvent(EvVolley, f.value);
+      break;
   }
-    */
 }
 
-IntentAndSlot ParseIntent(const String& msg){
-  IntentAndSlot out;
+void ServerPrintStats(){
+  Serial.printf("UDP frames: %lu bad: %lu stale: %lu text: %lu\n", (unsigned long) tpFrames, (unsigned long) tpBadFrames,
+                (unsigned long) tpStaleFrames, (unsigned long) textCommands);
+  Serial.printf("UDP packets: %lu depth: %u max: %u aim coalesced: %lu drain capped: %lu queued: %u dropped: %lu\n",
+                (unsigned long) udpPackets, udpDepth, udpMaxDepth, (unsigned long) aimCoalesced, (unsigned long) udpDrainCapped,
+                netRx.Count(), (unsigned long) netRx.Dropped());
+}
+
+// Text commands. A message is either <intent>{slot} or a verb with its argument straight after it
+// (AP12.5Y-3, B5, volleyT30, revOn). Intents and verbs are looked up in perfect hash tables built at
+// compile time, and everything is a view into the receive buffer.
 
-  int16_t intEndIndx = msg.indexOf(">");
-  if(msg.startsWith("<") && intEndIndx > 0 ){
-    out.intent = msg.substring(1, intEndIndx);
-    //Serial.println("parse int: " + out.intent);
+static bool StartsWith(std::string_view s, std::string_view prefix){
+  return s.substr(0, prefix.size()) == prefix;
+}
 
-    int16_t slotStartIndx = msg.indexOf("{");
-    int16_t slotEndIndx  = msg.indexOf("}");
+static float ViewToFloat(std::string_view s){
+  char buf[16];
+  size_t n = s.copy(buf, sizeof(buf) - 1);
+  buf[n] = 0;
+  return strtof(buf, NULL);
+}
 
-    if(slotStartIndx > 0 && slotEndIndx > 0){
-      out.slot = msg.substring(slotStartIndx+1, slotEndIndx);
-      //Serial.println("parse slot: " + out.slot);
-    }
+static int32_t ViewToInt(std::string_view s){
+  char buf[16];
+  size_t n = s.copy(buf, sizeof(buf) - 1);
+  buf[n] = 0;
+  return strtol(buf, NULL, 10);
+}
+
+// P12.5Y-3 without the verb
+static bool ParseAim(std::string_view arg, float &p, float &y){
+  size_t yIndx = arg.find('Y');
+  if(yIndx == std::string_view::npos)
+    return false;
+
+  p = ViewToFloat(arg.substr(0, yIndx));
+  y = ViewToFloat(arg.substr(yIndx + 1));
+  return true;
+}
+
+// Intents, arg is the slot
+
+static void IntentMaintenance(std::string_view){
+  turretMode = Default;
+
+  SendControl(CmdAim, 0, 0.0f, 0.0f);
+
+  if(ctlState.targetWingStates[0] == Closed){
+    SetWings(Open);
+  }else{
+    SetWings(Closed);
   }
+}
+
+static void IntentSing(std::string_view slot){
+  if(StartsWith(slot, "portal radio music")){
+    PlayAudio(radio_wav, radio_wav_len);
 
-  return out;
-}
\ No newline at end of file
+  }else if(StartsWith(slot, "turret opera")){
+    //PlayAudio(portal_opera_wav, portal_opera_wav_len);
+  }
+}
+
+static void IntentRateOfFire(std::string_view slot){
+  if(StartsWith(slot, "slow")){
+    fireRate = Slow;
+
+  }else if(StartsWith(slot, "medium")){
+    fireRate = Medium;
+
+  }else if(StartsWith(slot, "fast")){
+    fireRate = Fast;
+  }
+  SendControl(CmdFireDelay, fireDelays[fireRate]);
+  TelemLogEvent(EvFireRate, fireRate);
+}
+
+static void IntentSafety(std::string_view slot){
+  if(StartsWith(slot, "on")){
+    SendControl(CmdSafety, true);
+    TelemLogEvent(EvSafety, true);
+  }else if(StartsWith(slot, "off")){
+    SendControl(CmdSafety, false);
+    TelemLogEvent(EvSafety, false);
+  }
+}
+
+static void IntentFeedback(std::string_view){
+  feedBackMillis = millis();
+}
+
+static void IntentCakeIsALie(std::string_view){
+  PlayAudio(i_dont_hate_you_wav, i_dont_hate_you_wav_len);
+}
+
+static void IntentReturnAuto(std::string_view){
+  turretMode = Autonomous;
+  SetWings(Closed);
+  SendControl(CmdFire, false);
+  SendControl(CmdRev, false);
+}
+
+static void IntentControlOverride(std::string_view){
+  turretMode = GloveManual;
+  SendControl(CmdFire, false);
+  SendControl(CmdRev, false);
+  SetWings(Open);
+}
+
+static void IntentOpenStatus(std::string_view slot){
+  if(StartsWith(slot, "deploy")){
+    SetWings(Open);
+
+  }else if(StartsWith(slot, "retract")){
+    SetWings(Closed);
+  }
+}
+
+static void IntentMode(std::string_view slot){
+  if(StartsWith(slot, "auto")){
+    fireMode = Auto;
+  }else if(StartsWith(slot, "single")){
+    fireMode = Single;
+  }else if(StartsWith(slot, "burst")){
+    fireMode = Burst;
+  }else{
+    return;
+  }
+  TelemLogEvent(EvFireMode, fireMode);
+}
+
+// Verbs, arg is whatever follows the verb
+
+static void VerbAim(std::string_view arg){
+  float p, y;
+  if(turretMode == GloveManual && ParseAim(arg, p, y))
+    QueueAim(CmdAim, p, y);
+}
+
+static void VerbTrack(std::string_view arg){
+  float p, y;
+  if(turretMode == Autonomous && ParseAim(arg, p, y))
+    QueueAim(CmdTrack, p, y);
+}
+
+static void VerbAimLatency(std::string_view arg){ SendControl(CmdAimLatency, ViewToInt(arg)); }
+static void VerbBurst(std::string_view arg){ SendControl(CmdBurst, ViewToInt(arg)); }
+static void VerbOpen(std::string_view){ SetWings(Open); }
+static void VerbClose(std::string_view){ SetWings(Closed); }
+static void VerbRevOn(std::string_view){ SendControl(CmdRev, true); }
+static void VerbRevOff(std::string_view){ SendControl(CmdRev, false); }
+static void VerbFireOn(std::string_view){ SendControl(CmdFire, true); }
+static void VerbFireOff(std::string_view){ SendControl(CmdFire, false); }
+
+static void VerbAutoOpen(std::string_view){ if(turretMode == Autonomous) SetWings(Open); }
+static void VerbAutoClose(std::string_view){ if(turretMode == Autonomous) SetWings(Closed); }
+static void VerbAutoRevOn(std::string_view){ if(turretMode == Autonomous) SendControl(CmdRev, true); }
+static void VerbAutoRevOff(std::string_view){ if(turretMode == Autonomous) SendControl(CmdRev, false); }
+static void VerbAutoFireOn(std::string_view){ if(turretMode == Autonomous) SendControl(CmdFire, true); }
+static void VerbAutoFireOff(std::string_view){ if(turretMode == Autonomous) SendControl(CmdFire, false); }
+
+static void VerbStats(std::string_view){ ReplyStats(); }
+static void VerbTelem(std::string_view){ TelemSubscribe(netRemoteIP); }
+
+static void VerbVoicelineFound(std::string_view){
+  //TargetFoundVoiceline(); Commented: speaker makes the voicelines sad, plus it's crashing for some reason
+}
+
+static void Volley(VolleyPattern pattern, std::string_view arg){
+  int32_t offsetMs = ViewToInt(arg);
+  SendControl(CmdVolley, pattern, offsetMs);
+  TelemLogEvent(EvVolley, pattern | (offsetMs << 8));
+}
+
+static void VerbVolleyAlternate(std::string_view arg){ Volley(Alternate, arg); }
+static void VerbVolleySimultaneous(std::string_view arg){ Volley(Simultaneous, arg); }
+static void VerbVolleyStaggered(std::string_view arg){ Volley(Staggered, arg); } // volleyT<offset ms>
+
+struct TextCommand {
+  std::string_view name;
+  TextHandler fn;
+};
+
+constexpr TextCommand intents[] = {
+  {"maintenance", IntentMaintenance},
+  {"sing", IntentSing},
+  {"rateoffire", IntentRateOfFire},
+  {"safety", IntentSafety},
+  {"feedback", IntentFeedback},
+  {"cakeisalie", IntentCakeIsALie},
+  {"returnauto", IntentReturnAuto},
+  {"controlovr", IntentControlOverride},
+  {"openstatus", IntentOpenStatus},
+  {"mode", IntentMode},
+};
+
+constexpr TextCommand verbs[] = {
+  {"P", VerbAim},
+  {"AP", VerbTrack},
+  {"AL", VerbAimLatency},
+  {"B", VerbBurst},
+  {"open", VerbOpen},
+  {"close", VerbClose},
+  {"Aopen", VerbAutoOpen},
+  {"Aclose", VerbAutoClose},
+  {"ArevOn", VerbAutoRevOn},
+  {"ArevOff", VerbAutoRevOff},
+  {"AfireOn", VerbAutoFireOn},
+  {"AfireOff", VerbAutoFireOff},
+  {"revOn", VerbRevOn},
+  {"revOff", VerbRevOff},
+  {"fireOn", VerbFireOn},
+  {"fireOff", VerbFireOff},
+  {"stats", VerbStats},
+  {"telem", VerbTelem},
+  {"voiceline_found", VerbVoicelineFound},
+  {"volleyA", VerbVolleyAlternate},
+  {"volleyS", VerbVolleySimultaneous},
+  {"volleyT", VerbVolleyStaggered},
+};
+
+constexpr auto intentHash = MakePerfectHash<16>(intents);
+constexpr auto verbHash = MakePerfectHash<64>(verbs);
+static_assert(intentHash.seed && verbHash.seed, "No perfect hash for the text commands, make the table bigger");
+
+TextHandler FindTextCommand(std::string_view msg, std::string_view &arg){
+  while(!msg.empty() && (msg.back() == '\n' || msg.back() == '\r' || msg.back() == 0))
+    msg.remove_suffix(1);
+
+  const TextCommand *cmd;
+  size_t intentEnd = msg.find('>');
+  if(StartsWith(msg, "<") && intentEnd != std::string_view::npos){
+    cmd = intentHash.Find(intents, msg.substr(1, intentEnd - 1));
+
+    size_t slotStart = msg.find('{');
+    size_t slotEnd = msg.find('}');
+    arg = slotStart < slotEnd && slotEnd != std::string_view::npos ? msg.substr(slotStart + 1, slotEnd - slotStart - 1) : std::string_view();
+  }else{
+    size_t n = 0;
+    while(n < msg.size() && (isalpha((uint8_t) msg[n]) || msg[n] == '_'))
+      n++;
+
+    cmd = verbHash.Find(verbs, msg.substr(0, n));
+    arg = msg.substr(n);
+  }
+
+  return cmd ? cmd->fn : NULL;
+}
+
+static void DispatchText(TextHandler fn, std::string_view arg){
+  if(fn != VerbAim && fn != VerbTrack)
+    FlushAim();
+  fn(arg);
+}
+
+// One message on its own, aim included
+void ParseCommand(std::string_view msg){
+  std::string_view arg;
+  TextHandler fn = FindTextCommand(msg, arg);
+  if(fn)
+    DispatchText(fn, arg);
+  FlushAim();
+}
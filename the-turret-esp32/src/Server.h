@@ -1,13 +1,16 @@
 #include <Arduino.h>
 //#include <AsyncTCP.h>
-#include <WiFiUdp.h>
+#include <AsyncUDP.h>
+#include "PinsAndDefs.h"
+#include "TurretProtocol.h"
+#include "PerfectHash.h"
 
-struct IntentAndSlot {
-    String intent;
-    String slot;
-};
+typedef void (*TextHandler)(std::string_view arg);
 
 void InitServer();
 void ServerLoop();
-void ParseCommand(const String&);
-IntentAndSlot ParseIntent(const String&);
\ No newline at end of file
+void SetWings(WingState);
+TextHandler FindTextCommand(std::string_view msg, std::string_view &arg);
+void ParseCommand(std::string_view msg);
+void ParseFrame(const TpFrame&);
+void ServerPrintStats();
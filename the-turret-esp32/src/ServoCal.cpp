@@ -0,0 +1,122 @@
+#include "ServoCal.h"
+#include "AuxFuncs.h"
+#include "Telemetry.h"
+#include <Preferences.h>
+
+extern uint8_t pitchServoIndxs[];
+extern uint8_t yawServoIndxs[];
+
+ServoLut servoLuts[AIM_SERVOS] = {};
+uint8_t servoCalServo = AIM_SERVOS; // Being calibrated, AIM_SERVOS = none
+uint8_t servoCalKnot = 0;
+
+static void ServoLutDefault(ServoLut &lut){
+    lut.version = SERVO_CAL_VERSION;
+    lut.points = SERVO_CAL_POINTS;
+    for(uint8_t k = 0; k < SERVO_CAL_POINTS; k++)
+        lut.pwm[k] = pwmServo.pwmForAngle((SERVO_CAL_MIN_CD + k * SERVO_CAL_STEP_CD) / 100.0f);
+}
+
+static void ServoLutKey(char *key, uint8_t servo){
+    snprintf(key, 8, "lut%u", servo);
+}
+
+void InitServoCal(){
+    Preferences prefs;
+    bool stored = prefs.begin("servocal", true);
+
+    for(uint8_t i = 0; i < AIM_SERVOS; i++){
+        char key[8];
+        ServoLutKey(key, i);
+
+        ServoLut &lut = servoLuts[i];
+        if(stored && prefs.getBytesLength(key) == sizeof(ServoLut) && prefs.getBytes(key, &lut, sizeof(ServoLut)) == sizeof(ServoLut) &&
+           lut.version == SERVO_CAL_VERSION && lut.points == SERVO_CAL_POINTS)
+            continue;
+
+        ServoLutDefault(lut); // Never calibrated, or the table layout changed since
+    }
+
+    if(stored)
+        prefs.end();
+}
+
+uint8_t ServoPWMIndx(uint8_t servo){
+    return servo & 1 ? yawServoIndxs[servo >> 1] : pitchServoIndxs[servo >> 1];
+}
+
+uint16_t ServoCalPWM(uint8_t servo, int16_t cd){
+    const uint16_t *pwm = servoLuts[servo].pwm;
+
+    int32_t x = constrain(cd, SERVO_CAL_MIN_CD, SERVO_CAL_MAX_CD) - SERVO_CAL_MIN_CD;
+    uint8_t k = x / SERVO_CAL_STEP_CD;
+    if(k >= SERVO_CAL_POINTS - 1)
+        return pwm[SERVO_CAL_POINTS - 1];
+
+    int32_t num = ((int32_t) pwm[k + 1] - pwm[k]) * (x - k * SERVO_CAL_STEP_CD);
+    return pwm[k] + (num + (num >= 0 ? SERVO_CAL_STEP_CD / 2 : -SERVO_CAL_STEP_CD / 2)) / SERVO_CAL_STEP_CD;
+}
+
+bool ServoCalHolds(uint8_t servo){
+    return servo == servoCalServo;
+}
+
+static void ServoCalShow(){
+    if(servoCalServo >= AIM_SERVOS){
+        TelemLogText("Servo cal off");
+        return;
+    }
+
+    uint16_t pwm = servoLuts[servoCalServo].pwm[servoCalKnot];
+    WritePWMRaw(ServoPWMIndx(servoCalServo), pwm);
+
+    char text[32];
+    snprintf(text, sizeof(text), "Servo %u %s %ddeg: %u", servoCalServo >> 1, servoCalServo & 1 ? "yaw" : "pitch",
+             (SERVO_CAL_MIN_CD + servoCalKnot * SERVO_CAL_STEP_CD) / 100, pwm);
+    TelemLogText(text);
+}
+
+static void ServoCalSave(){
+    Preferences prefs;
+    if(!prefs.begin("servocal", false)){
+        TelemLogText("Servo cal: no NVS");
+        return;
+    }
+
+    for(uint8_t i = 0; i < AIM_SERVOS; i++){
+        char key[8];
+        ServoLutKey(key, i);
+        prefs.putBytes(key, &servoLuts[i], sizeof(ServoLut));
+    }
+    prefs.end();
+    TelemLogText("Servo cal saved");
+}
+
+// Control task only, these come in as CmdServoCal. The NVS write stalls the tick, which is fine
+// while someone is sitting there calibrating.
+void ServoCalCommand(ServoCalAction action, int32_t arg){
+    if(action == CalNextServo){
+        servoCalServo = servoCalServo >= AIM_SERVOS ? 0 : servoCalServo + 1;
+        servoCalKnot = SERVO_CAL_POINTS / 2; // 0deg, the rest of the travel may hit the wing
+        ServoCalShow();
+        return;
+    }
+
+    if(action == CalSave){
+        ServoCalSave();
+        return;
+    }
+
+    if(servoCalServo >= AIM_SERVOS)
+        return;
+
+    ServoLut &lut = servoLuts[servoCalServo];
+    if(action == CalKnot){
+        servoCalKnot = constrain(servoCalKnot + arg, 0, SERVO_CAL_POINTS - 1);
+    }else if(action == CalJog){
+        lut.pwm[servoCalKnot] = constrain(lut.pwm[servoCalKnot] + arg, 0, 4095);
+    }else if(action == CalDefault){
+        ServoLutDefault(lut);
+    }
+    ServoCalShow();
+}
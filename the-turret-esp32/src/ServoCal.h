@@ -0,0 +1,45 @@
+#ifndef SERVO_CAL_H
+#define SERVO_CAL_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Per-servo angle to PWM lookup tables for the aim servos. Each table has one PWM count every
+// SERVO_CAL_STEP_CD centidegrees from SERVO_CAL_MIN_CD to SERVO_CAL_MAX_CD. WriteServo()
+// interpolates between two entries in integer math. The tables start as the linear pwmServo
+// mapping and are kept in NVS once they've been calibrated.
+//
+// To calibrate, 'v' picks the next servo and points it at its 0deg knot. Then '[' ']' move it one
+// count and '{' '}' ten counts until it really is at that angle. 'n' and 'b' go to the next and
+// previous knot, 'V' saves every table, and 'X' puts the selected servo back on the linear mapping.
+// WriteServo() leaves the selected servo alone until 'v' has gone past the last one.
+
+#define SERVO_CAL_MIN_CD -9000
+#define SERVO_CAL_MAX_CD 9000
+#define SERVO_CAL_STEP_CD 1000
+#define SERVO_CAL_POINTS ((SERVO_CAL_MAX_CD - SERVO_CAL_MIN_CD) / SERVO_CAL_STEP_CD + 1)
+#define SERVO_CAL_VERSION 1
+
+#define SERVO_PITCH(wing) (2 * (wing))
+#define SERVO_YAW(wing) (2 * (wing) + 1)
+#define AIM_SERVOS (2 * WINGS)
+
+enum ServoCalAction : uint8_t {CalNextServo, CalKnot, CalJog, CalSave, CalDefault}; // a = knots/counts for CalKnot/CalJog
+
+struct ServoLut {
+    uint8_t version;
+    uint8_t points;
+    uint16_t pwm[SERVO_CAL_POINTS];
+};
+
+inline int16_t ServoCd(float deg){
+    return (int16_t) lroundf(deg * 100.0f);
+}
+
+void InitServoCal();
+uint8_t ServoPWMIndx(uint8_t servo);
+uint16_t ServoCalPWM(uint8_t servo, int16_t cd);
+bool ServoCalHolds(uint8_t servo);
+void ServoCalCommand(ServoCalAction action, int32_t arg);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single producer / single consumer ring, safe across the two cores as long as only one
+// task pushes and only one task pops. N must be a power of two; one slot is always kept free.
+
+template<typename T, uint16_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool Push(const T &item){
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        uint16_t next = (head + 1) & (N - 1);
+
+        if(next == _tail.load(std::memory_order_acquire)){
+            _dropped++;
+            return false;
+        }
+
+        _buf[head] = item;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T &item){
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+
+        if(tail == _head.load(std::memory_order_acquire))
+            return false;
+
+        item = _buf[tail];
+        _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    uint16_t Count() const {
+        return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+    uint32_t Dropped() const { return _dropped; }
+
+private:
+    T _buf[N];
+    std::atomic<uint16_t> _head{0};
+    std::atomic<uint16_t> _tail{0};
+    uint32_t _dropped = 0; // Only touched by the producer
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "Telemetry.h"
+#include "Control.h"
+#include "Profiler.h"
+#include <WiFiUdp.h>
+
+struct TelemRec {
+    uint8_t type;
+    uint8_t len;
+    uint8_t data[TELEM_MAX_PAYLOAD];
+};
+
+SpscQueue<TelemRec, TELEM_CTL_QUEUE_LEN> telemCtl;
+SpscQueue<TelemRec, TELEM_APP_QUEUE_LEN> telemApp;
+
+WiFiUDP telemUdp;
+IPAddress telemUdpIP;
+bool telemUdpOn = false;
+
+uint32_t telemBytes = 0;
+
+static uint8_t Crc8(const uint8_t *data, uint8_t len, uint8_t crc){
+    while(len--){
+        crc ^= *data++;
+        for(uint8_t b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
+
+bool TelemPush(TelemType type, const void *data, uint8_t len){
+    TelemRec rec;
+    rec.type = type;
+    rec.len = min(len, (uint8_t) TELEM_MAX_PAYLOAD);
+    memcpy(rec.data, data, rec.len);
+
+    if(xPortGetCoreID() == CONTROL_CORE)
+        return telemCtl.Push(rec);
+    return telemApp.Push(rec);
+}
+
+void TelemLogEvent(TelemEventCode code, int32_t value){
+    TelemEventRec ev = {(uint32_t) millis(), code, value};
+    TelemPush(TelemEvent, &ev, sizeof(ev));
+}
+
+void TelemLogText(const char *text){
+    uint8_t buf[TELEM_MAX_PAYLOAD];
+    uint32_t now = millis();
+    memcpy(buf, &now, sizeof(now));
+
+    uint8_t len = strnlen(text, TELEM_MAX_PAYLOAD - sizeof(now));
+    while(len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r'))
+        len--;
+    memcpy(buf + sizeof(now), text, len);
+
+    TelemPush(TelemText, buf, sizeof(now) + len);
+}
+
+void TelemSubscribe(IPAddress ip){
+    telemUdpIP = ip;
+    telemUdpOn = true;
+}
+
+static uint8_t Frame(const TelemRec &rec, uint8_t *out){
+    out[0] = TELEM_SYNC;
+    out[1] = rec.type;
+    out[2] = rec.len;
+    memcpy(out + 3, rec.data, rec.len);
+    out[3 + rec.len] = Crc8(out + 1, rec.len + 2, 0);
+    return rec.len + 4;
+}
+
+static uint8_t udpPacket[512];
+static uint16_t udpPacketLen = 0;
+
+static void FlushUdp(){
+    if(!udpPacketLen)
+        return;
+
+    telemUdp.beginPacket(telemUdpIP, TELEM_UDP_PORT);
+    telemUdp.write(udpPacket, udpPacketLen);
+    telemUdp.endPacket();
+    udpPacketLen = 0;
+}
+
+static void Emit(const TelemRec &rec){
+    uint8_t frame[TELEM_MAX_PAYLOAD + 4];
+    uint8_t len = Frame(rec, frame);
+
+    Serial.write(frame, len);
+    telemBytes += len;
+
+    if(telemUdpOn){
+        if(udpPacketLen + len > sizeof(udpPacket))
+            FlushUdp();
+        memcpy(udpPacket + udpPacketLen, frame, len);
+        udpPacketLen += len;
+    }
+}
+
+void TelemetryDrain(){
+    static uint32_t lastDropped = 0;
+    TelemRec rec;
+
+    uint32_t cycles = ProfStart();
+
+    uint32_t dropped = telemCtl.Dropped() + telemApp.Dropped();
+    if(dropped != lastDropped){ // Straight out, we're not a producer on either ring
+        TelemEventRec ev = {(uint32_t) millis(), EvTelemDropped, (int32_t) (dropped - lastDropped)};
+        rec.type = TelemEvent;
+        rec.len = sizeof(ev);
+        memcpy(rec.data, &ev, sizeof(ev));
+        Emit(rec);
+        lastDropped = dropped;
+    }
+
+    while(telemCtl.Pop(rec) || telemApp.Pop(rec))
+        Emit(rec);
+
+    FlushUdp();
+
+    ProfEnd(ProfTelemetry, cycles);
+}
+
+static void TelemetryTask(void *){
+    for(;;){
+        TelemetryDrain();
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+void InitTelemetry(){
+    xTaskCreatePinnedToCore(TelemetryTask, "Telemetry", 4096, NULL, TELEM_TASK_PRIO, NULL, APP_CORE);
+}
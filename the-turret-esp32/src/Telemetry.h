@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Binary telemetry. Records go into one lock-free ring per core (the control task logs into one,
+// the app task into the other) and TelemetryTask drains them at low priority, framed as
+//   0xA5 type len payload[len] crc8
+// over serial and, if someone sent "telem", over UDP to them. Anything on serial that isn't a
+// valid frame is plain text. tools/telemetry_decode.py decodes both.
+// Only the control task and the app task may log, the ring is picked by xPortGetCoreID().
+
+#define TELEM_SYNC 0xA5
+#define TELEM_MAX_PAYLOAD 40
+#define TELEM_CTL_QUEUE_LEN 64
+#define TELEM_APP_QUEUE_LEN 32
+#define TELEM_STATUS_HZ 20
+#define TELEM_UDP_PORT 4211
+#define TELEM_TASK_PRIO 1
+
+enum TelemType : uint8_t {TelemStatus = 1, TelemEvent = 2, TelemText = 3};
+
+enum TelemEventCode : uint8_t {
+    EvWingOpen = 1,   // value = wing
+    EvWingClosed,     // value = wing
+    EvFeedState,      // value = wing | FeedState << 8
+    EvFireRate,       // value = FireRate
+    EvFireMode,       // value = FireMode
+    EvSafety,         // value = 0/1
+    EvControlQueueFull,
+    EvTelemDropped,   // value = records lost since the last one of these
+    EvRevReady,       // value = wing | spin up ms << 8
+    EvRevTimeout,     // value = wing, current never settled, fell back to FIRE_REV_MS
+    EvVolley          // value = VolleyPattern | stagger offset ms << 8
+};
+
+struct __attribute__((packed)) TelemStatusRec {
+    uint32_t timeMs;
+    uint8_t wing[WINGS];     // WingState | target WingState << 4
+    uint8_t fireFeed[WINGS]; // FireState | FeedState << 4
+    uint16_t flags;          // TELEM_FLAG_*
+    int16_t pitchCd;         // Commanded aim, centidegrees
+    int16_t yawCd;
+    int8_t BBBalance[WINGS];
+    uint16_t burstCount;
+    int16_t currentMA[WINGS];
+    uint16_t busMV[WINGS];
+};
+
+static_assert(sizeof(TelemStatusRec) <= TELEM_MAX_PAYLOAD, "Status record doesn't fit a telemetry frame");
+
+#define TELEM_FLAG_FIRE (1 << 0)
+#define TELEM_FLAG_REV (1 << 1)
+#define TELEM_FLAG_SAFETY (1 << 2)
+#define TELEM_FLAG_TRACKING (1 << 3)
+#define TELEM_FLAG_OPEN_SW(i) (1 << (4 + 2 * (i)))
+#define TELEM_FLAG_CLOSED_SW(i) (1 << (5 + 2 * (i)))
+
+struct __attribute__((packed)) TelemEventRec {
+    uint32_t timeMs;
+    uint8_t code;
+    int32_t value;
+};
+
+void InitTelemetry();
+bool TelemPush(TelemType type, const void *data, uint8_t len);
+void TelemLogEvent(TelemEventCode code, int32_t value = 0);
+void TelemLogText(const char *text);
+void TelemSubscribe(IPAddress ip); // Also send frames over UDP to ip
+void TelemetryDrain();
+
+#endif
@@ -0,0 +1,78 @@
+#include "Volley.h"
+#include <esp_timer.h>
+
+VolleyPattern volleyPattern = Alternate;
+uint32_t volleyOffsetUs = 0;
+
+uint8_t nextFire = 0;                 // Alternate: whose turn it is
+uint64_t volleyChainUs = 0;           // Alternate: end of the last armed shot
+uint64_t volleyNextUs[WINGS] = {};    // Earliest each wing's next shot may start
+uint64_t volleyArmedUs[WINGS] = {};   // When each wing's last armed shot starts
+
+void SetVolley(VolleyPattern pattern, uint32_t offsetMs){
+    volleyPattern = pattern;
+    volleyOffsetUs = offsetMs * 1000UL;
+}
+
+// Hands back when wing should fire a shot lasting cycleUs (on + off + delay), or false if it
+// isn't its turn. Once this says yes the shot has to be armed.
+bool VolleyPlan(uint8_t wing, uint32_t cycleUs, uint64_t &atUs){
+    uint64_t now = esp_timer_get_time();
+
+    if(volleyPattern == Alternate){
+        if(nextFire != wing)
+            return false;
+
+        atUs = max(volleyChainUs, now);
+        volleyChainUs = atUs + cycleUs;
+
+        nextFire++;
+        if(nextFire == WINGS){
+            nextFire = 0;
+        }
+    }else{
+        bool idle = true; // Nobody has anything coming up, this starts a new volley
+        for(uint8_t i = 0; i < WINGS; i++)
+            if(volleyNextUs[i] > now)
+                idle = false;
+
+        if(idle){
+            uint32_t offset = volleyOffsetUs ? volleyOffsetUs : cycleUs / WINGS;
+            for(uint8_t i = 0; i < WINGS; i++)
+                volleyNextUs[i] = now + (volleyPattern == Staggered ? (uint64_t) offset * ((i + WINGS - wing) % WINGS) : 0);
+        }
+
+        atUs = max(volleyNextUs[wing], now);
+        volleyChainUs = max(volleyChainUs, atUs + cycleUs);
+    }
+
+    volleyArmedUs[wing] = atUs;
+    volleyNextUs[wing] = atUs + cycleUs;
+    return true;
+}
+
+// Wing can't fire right now (clearing a jam), let the others go ahead
+void VolleySkip(uint8_t wing){
+    if(volleyPattern == Alternate && nextFire == wing){
+        nextFire++;
+        if(nextFire == WINGS){
+            nextFire = 0;
+        }
+    }
+}
+
+// The armed shot was dropped before it fired, undo what VolleyPlan did for it
+void VolleyCancel(uint8_t wing){
+    if(volleyPattern == Alternate){
+        nextFire = wing;
+        volleyChainUs = volleyArmedUs[wing];
+    }
+    volleyNextUs[wing] = volleyArmedUs[wing];
+}
+
+// Shots per second one wing fires at in full auto with this cycle
+float VolleyWingHz(uint32_t cycleUs){
+    if(volleyPattern == Alternate)
+        return 1000000.0f / cycleUs / WINGS;
+    return 1000000.0f / cycleUs;
+}
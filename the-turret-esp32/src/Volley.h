@@ -0,0 +1,22 @@
+#ifndef VOLLEY_H
+#define VOLLEY_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+
+// Decides when each wing's next shot goes off, FireLoop arms whatever this hands back.
+//  Alternate: one wing after the other, each shot waits for the previous one to finish (the old
+//             nextFire round-robin). Only one solenoid is ever busy.
+//  Simultaneous: every wing runs its own cycle, all starting together.
+//  Staggered: every wing runs its own cycle, wing n starting n * offset after wing 0. An offset of 0
+//             spreads them evenly over the cycle.
+// In the last two each wing is only held back by its own solenoid, so full auto rate goes up with
+// the number of wings.
+
+void SetVolley(VolleyPattern pattern, uint32_t offsetMs);
+bool VolleyPlan(uint8_t wing, uint32_t cycleUs, uint64_t &atUs);
+void VolleySkip(uint8_t wing);
+void VolleyCancel(uint8_t wing);
+float VolleyWingHz(uint32_t cycleUs);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef WING_ARRAY_H
+#define WING_ARRAY_H
+
+#include <Arduino.h>
+#include "PinsAndDefs.h"
+#include "Motion.h"
+
+// All the per wing state the control task keeps, one array per field (struct of arrays) so a pass
+// over every wing walks each field contiguously. N is the wing count, nothing in here or in the
+// state machines that use it assumes 2.
+
+constexpr uint8_t WING_STATE_COUNT = Zeroing + 1;
+static_assert(Unknown == 0 && Open == 1 && Closing == 2 && ClosingSlow == 3 && Closed == 4 && Opening == 5 && Zeroing == 6,
+              "Zeroing has to stay the last WingState, the wing tables are sized from it");
+constexpr uint8_t FEED_STATE_COUNT = Cooldown + 1;
+
+template<uint8_t N>
+struct WingArray {
+    static constexpr uint8_t count = N;
+
+    // Wing open/close
+    WingState wingStates[N];
+    WingState targetWingStates[N];
+    uint64_t timer[N];
+
+    // Aim
+    float pitches[N];
+    float yaws[N];
+    AxisProfile pitchProfiles[N];
+    AxisProfile yawProfiles[N];
+
+    // Firing
+    bool revStartDebounce[N];
+    FireState fireStates[N];
+    uint32_t fireShotsSeen[N];
+    bool fireArmedBurst[N];
+
+    // Feeding
+    uint32_t lastPaddleCount[N];
+    int16_t BBBalance[N];
+    FeedState feedStates[N];
+    uint64_t feedTimer[N];
+};
+
+// One step of a state machine for wing i. The loops pick which one to run by indexing a constexpr
+// table with the wing's state, so adding wings adds passes, not branches.
+template<uint8_t N>
+using WingStep = void (*)(WingArray<N> &w, uint8_t i);
+
+#endif
@@ -1,21 +1,37 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include <esp_timer.h>
 #include <AsyncTCP.h>
 #include "PCA9685.h"
 #include "AuxFuncs.h"
 #include "PinsAndDefs.h"
 #include "Audio.h"
+#include "Server.h"
+#include "Scheduler.h"
+#include "Control.h"
+#include "Motion.h"
+#include "AimFilter.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "Endstops.h"
+#include "FireEngine.h"
+#include "RevDetect.h"
+#include "MotorStart.h"
+#include "ServoCal.h"
+#include "PowerSampler.h"
+#include "JamDetect.h"
+#include "Volley.h"
+#include "FeedControl.h"
+#include "WingArray.h"
+#include "Latency.h"
 
 
-extern PCA9685 pwm;
 extern PCA9685_ServoEval pwmServo;
 
 extern uint8_t closedSWPins[];
 extern uint8_t openSWPins[];
 
 extern uint8_t expServoIndxs[];
-extern uint8_t pitchServoIndxs[];
-extern uint8_t yawServoIndxs[];
 
 extern uint8_t feederSensePins[];
 extern uint8_t fireSolenoidPins[];
@@ -23,323 +39,602 @@ extern uint8_t revIndxs[];
 
 extern float pitchOffts[];
 extern float yawOffts[];
+extern float pitchSigns[];
+extern float yawMinAngles[];
+extern float yawMaxAngles[];
+
+extern float pitchMaxVel[];
+extern float pitchMaxAcc[];
+extern float yawMaxVel[];
+extern float yawMaxAcc[];
 
 extern uint16_t fireDelays[];
-extern FireRate fireRate;
+
+// Everything below is owned by the control task, the app side only sees it through Control.h
 
 float pitch = 0;
 float yaw = 0;
 
+AimFilter aimFilter = {};
+bool tracking = false; // pitch/yaw come from aimFilter rather than straight from packets
+float aimHostLatencyMs = AIM_HOST_LATENCY_MS;
+float aimQueueMs = 0; // How long AP packets wait between arriving and reaching us
+
 bool fire = false;
 bool doRev = false;
 bool safety = false;
 uint16_t burstCount = 0;
+uint16_t fireDelayMs = FIRE_DELAY_FAST;
 
-WingState wingStates[WINGS] = {};
-WingState targetWingStates[2] = {};
-uint64_t timer[WINGS] = {};
+WingArray<WINGS> wings = {};
+uint64_t paddleMovementMs = 0;
+float nominalFeedDuty = 0.0f; // What FeedControl wants, FeedNominal applies it
 
-float pitches[WINGS] = {};
-float yaws[WINGS] = {};
+// Wing open/close. The transition table is indexed [target][state], the steady table by state alone
+// and runs after it, so a wing that just reached Open starts aiming on the same pass.
 
-bool revStartDebounce[WINGS] = {};
-uint64_t revStartMs[WINGS] = {};
-FireState fireStates[WINGS] = {};
-uint64_t fireTimer[WINGS] = {};
-uint8_t nextFire = 0;
-uint64_t paddleMovementMs = 0;
+template<uint8_t N> void WingNothing(WingArray<N> &, uint8_t){}
 
-bool lastPaddleState[WINGS] = {};
-uint64_t lastPaddleDebounceMillis[WINGS] = {};
-int16_t BBBalance[WINGS] = {};
-FeedState feedStates[WINGS] = {};
-uint64_t feedTimer[WINGS] = {};
+template<uint8_t N> void WingStartZeroing(WingArray<N> &w, uint8_t i, bool shouldWait){
+    w.wingStates[i] = Zeroing;
 
-void WingLoop(){
-  digitalWrite(LASERS_PIN, doRev && targetWingStates[0] == Open);
+    WriteServo(SERVO_PITCH(i), ServoCd(pitchOffts[i]));
+    WriteServo(SERVO_YAW(i), ServoCd(yawOffts[i]));
+    ResetProfile(w.pitchProfiles[i], pitchOffts[i]); //Opening again ramps out from here
+    ResetProfile(w.yawProfiles[i], yawOffts[i]);
+
+    w.timer[i] = millis() + (shouldWait ? CLOSE_ZEROING_TIME_MS : 0);
+}
+
+template<uint8_t N> void WingCloseFromOpen(WingArray<N> &w, uint8_t i){
+    WingStartZeroing(w, i, true);
+}
+
+template<uint8_t N> void WingCloseFromOpening(WingArray<N> &w, uint8_t i){
+    WingStartZeroing(w, i, false);
+}
+
+template<uint8_t N> void WingZeroing(WingArray<N> &w, uint8_t i){
+    if(millis() >= w.timer[i]){
+        WriteServoSpeed(expServoIndxs[i], 1.0f);
+        w.wingStates[i] = Closing;
+    }
+}
+
+template<uint8_t N> void WingClosing(WingArray<N> &w, uint8_t i){
+    if(digitalRead(closedSWPins[i])){
+        WriteServoSpeed(expServoIndxs[i], CLOSE_EXTRA_SPEED);
+        w.wingStates[i] = ClosingSlow; //Begin close slow, keep going slower for a little longer so we're truly at end of travel
+        w.timer[i] = millis() + CLOSE_EXTRA_TIME_MS;
+    }
+}
+
+template<uint8_t N> void WingClosingSlow(WingArray<N> &w, uint8_t i){
+    if(millis() >= w.timer[i]){
+        WriteServoSpeed(expServoIndxs[i], 0.0f);
+        w.wingStates[i] = Closed;
+        TelemLogEvent(EvWingClosed, i);
+    }
+}
+
+template<uint8_t N> void WingOpening(WingArray<N> &w, uint8_t i){
+    WriteServoSpeed(expServoIndxs[i], -0.9f);
+    w.wingStates[i] = Opening;
+
+    if(!digitalRead(openSWPins[i])){
+        w.wingStates[i] = Open;
+        WriteServoSpeed(expServoIndxs[i], 0.0f);
+        TelemLogEvent(EvWingOpen, i);
+    }
+}
+
+template<uint8_t N> void WingAim(WingArray<N> &w, uint8_t i){
+    float p = (w.pitches[i] + pitchOffts[i]) * pitchSigns[i];
+    float y = constrain(w.yaws[i] + yawOffts[i], yawMinAngles[i], yawMaxAngles[i]);
+
+    const float dt = 1.0f / WING_LOOP_HZ;
+    WriteServo(SERVO_PITCH(i), ServoCd(StepProfile(w.pitchProfiles[i], constrain(-p, PITCH_MIN_ANGLE, PITCH_MAX_ANGLE), dt)));
+    WriteServo(SERVO_YAW(i), ServoCd(StepProfile(w.yawProfiles[i], y, dt)));
+}
+
+template<uint8_t N> struct WingTables {
+    WingStep<N> transition[WING_STATE_COUNT][WING_STATE_COUNT]; // [target][state]
+    WingStep<N> steady[WING_STATE_COUNT];
+};
 
-  for(uint8_t i = 0; i < WINGS; i++){
-    pitches[i] = pitch;
-    yaws[i] = yaw;
+template<uint8_t N> constexpr WingTables<N> MakeWingTables(){
+    WingTables<N> t = {};
+
+    for(uint8_t target = 0; target < WING_STATE_COUNT; target++){
+        for(uint8_t state = 0; state < WING_STATE_COUNT; state++)
+            t.transition[target][state] = target == Open && state != Open ? WingOpening<N> : WingNothing<N>;
+        t.steady[target] = WingNothing<N>;
+    }
+
+    t.transition[Closed][Open] = WingCloseFromOpen<N>;
+    t.transition[Closed][Opening] = WingCloseFromOpening<N>;
+    t.transition[Closed][Zeroing] = WingZeroing<N>;
+    t.transition[Closed][Closing] = WingClosing<N>;
+    t.transition[Closed][ClosingSlow] = WingClosingSlow<N>;
+    t.steady[Open] = WingAim<N>;
+    return t;
+}
+
+template<uint8_t N> constexpr WingTables<N> wingTables = MakeWingTables<N>();
+
+template<uint8_t N> void StepWings(WingArray<N> &w){
+    for(uint8_t i = 0; i < N; i++){
+        w.pitches[i] = pitch;
+        w.yaws[i] = yaw;
+
+        wingTables<N>.transition[w.targetWingStates[i]][w.wingStates[i]](w, i);
+        wingTables<N>.steady[w.wingStates[i]](w, i);
+    }
+}
 
-    if(wingStates[i] != targetWingStates[i]){
-      if(targetWingStates[i] == Closed){ //=====-----
+void WingLoop(){
+    digitalWrite(LASERS_PIN, doRev && wings.targetWingStates[0] == Open);
 
-        if(wingStates[i] == Open || wingStates[i] == Opening){
-          bool shouldWait = wingStates[i] == Open;
-          wingStates[i] = Zeroing;
+    if(tracking)
+        AimFilterPredict(aimFilter, micros(), aimHostLatencyMs + aimQueueMs, pitch, yaw);
 
-          WriteServo(pitchServoIndxs[i], pitchOffts[i]);
-          WriteServo(yawServoIndxs[i], yawOffts[i]);
+    StepWings(wings);
+}
 
-          timer[i] = millis() + (shouldWait ? CLOSE_ZEROING_TIME_MS : 0);
+// Runs as soon as an endstop interrupt fires, WingLoop still polls the switches as a fallback
+void HandleEndstops(){
+    uint64_t us;
 
-        }else if(wingStates[i] == Zeroing){
-          if(millis() >= timer[i]){
-            WriteServoSpeed(expServoIndxs[i], 1.0f);
-            wingStates[i] = Closing;
-          }
-          
-        }else if(wingStates[i] == Closing){
-          if(digitalRead(closedSWPins[i])){
+    for(uint8_t i = 0; i < WINGS; i++){
+        if(EndstopTakeClosed(i, us) && wings.wingStates[i] == Closing && wings.targetWingStates[i] == Closed){
             WriteServoSpeed(expServoIndxs[i], CLOSE_EXTRA_SPEED);
-            wingStates[i] = ClosingSlow; //Begin close slow, keep going slower for a little longer so we're truly at end of travel
-            timer[i] = millis() + CLOSE_EXTRA_TIME_MS;
-          }
+            wings.wingStates[i] = ClosingSlow;
+            // From when the switch was hit, not from now, moved onto the millis() clock WingClosingSlow checks
+            wings.timer[i] = millis() - (uint32_t) ((esp_timer_get_time() - us) / 1000) + CLOSE_EXTRA_TIME_MS;
+        }
 
-        }else if(wingStates[i] == ClosingSlow){
-          if(millis() >= timer[i]){
-            
+        if(EndstopTakeOpen(i, us) && wings.wingStates[i] == Opening && wings.targetWingStates[i] == Open){
+            wings.wingStates[i] = Open;
             WriteServoSpeed(expServoIndxs[i], 0.0f);
-            wingStates[i] = Closed;
-            Serial.println("Closed");
-          }
+            TelemLogEvent(EvWingOpen, i);
         }
+    }
 
+    FlushPWM();
+}
+
+// Firing, indexed by whether the wing may fire at all (revving, no safety, open)
+
+template<uint8_t N> void FireDisarmed(WingArray<N> &w, uint8_t i){
+    w.revStartDebounce[i] = false;
+    RevDetectStop(i);
+    w.BBBalance[i] = 0;
+    burstCount = 0;
+    MotorSetDuty(MOTOR_REV(i), 0.0f);
+    FireEngineStop(i);
+    w.fireShotsSeen[i] = FireEngineShots(i);
+    w.fireStates[i] = FireEngineState(i);
+}
 
-      }else if(targetWingStates[i] == Open){ //=====-----
-        WriteServoSpeed(expServoIndxs[i], -0.9f);
-        wingStates[i] = Opening;
-        
+template<uint8_t N> void FireArmed(WingArray<N> &w, uint8_t i){
+    MotorSetDuty(MOTOR_REV(i), fire ? FIRE_REV_ACTIVE_COEF : FIRE_REV_IDLE_COEF);
 
-        if(!digitalRead(openSWPins[i])){
-          wingStates[i] = Open;
-          WriteServoSpeed(expServoIndxs[i], 0.0f);
-          Serial.println("Open");
+    if(!w.revStartDebounce[i] && MotorStarted(MOTOR_REV(i))){ // Spin up counts from when MotorStart let it go
+        w.revStartDebounce[i] = true;
+
+        paddleMovementMs = millis();
+        RevDetectStart(i);
+    }
+
+    bool held = w.feedStates[i] == Jam || w.feedStates[i] == Clump;
+    if(held){ // Let the other wing keep firing while this one clears
+        VolleySkip(i);
+    }
+
+    // Shots are armed ahead of time, during the last one's off time, so they go off exactly
+    // when the volley pattern says. FireEngine does the edges.
+    uint64_t at;
+    uint32_t offMs = FIRE_OFF_MS + ((burstCount > 1) ? FIRE_DELAY_BURST : fireDelayMs); // Last shot of a burst gets the normal delay
+    if(FireEngineCanArm(i) && (fire || burstCount > 0) && !held && RevReady(i) &&
+       VolleyPlan(i, (FIRE_ON_MS + offMs) * 1000UL, at)){
+        w.fireArmedBurst[i] = burstCount > 0;
+        if(burstCount > 0){
+            burstCount--;
         }
-      }
+
+        FireEngineShot(i, at, FIRE_ON_MS * 1000UL, offMs * 1000UL);
+        paddleMovementMs = millis();
+    }else if(!fire && !w.fireArmedBurst[i] && FireEngineCancel(i)){
+        VolleyCancel(i); // Never fired, give its slot back
     }
 
-    if(wingStates[i] == Open){
-        float p = pitches[i] + pitchOffts[i];
-        if(i == 1)
-            p *= -1.0f;
-        
-        float y = yaws[i] + yawOffts[i];
-        if(i == 0)
-            y = constrain(yaws[i], YAW_MIN_ANGLE, YAW_MAX_ANGLE);
-        else
-            y = constrain(yaws[i], -YAW_MAX_ANGLE, -YAW_MIN_ANGLE);
-
-        WriteServo(pitchServoIndxs[i], constrain(-p, PITCH_MIN_ANGLE, PITCH_MAX_ANGLE));
-        WriteServo(yawServoIndxs[i], y);
+    if(FireEngineShots(i) != w.fireShotsSeen[i]){
+        w.fireShotsSeen[i] = FireEngineShots(i);
+        w.BBBalance[i] -= 1;
     }
 
-  }
+    w.fireStates[i] = FireEngineState(i);
+}
+
+template<uint8_t N> constexpr WingStep<N> fireSteps[2] = {FireDisarmed<N>, FireArmed<N>};
+
+template<uint8_t N> void StepFire(WingArray<N> &w){
+    for(uint8_t i = 0; i < N; i++)
+        fireSteps<N>[doRev && !safety && w.targetWingStates[i] == Open](w, i);
 }
 
 void FireLoop(){
-    for(uint8_t i = 0; i < WINGS; i++){
-        if(doRev && !safety && targetWingStates[0] == Open){
-            if(!revStartDebounce[i]){
-                revStartDebounce[i] = true;
-                
-                paddleMovementMs = millis();
-                revStartMs[i] = millis() + FIRE_REV_MS;
-            }
-
-            if(fire){
-                WritePWMDuty(revIndxs[i], FIRE_REV_ACTIVE_COEF);
-            }else{
-                WritePWMDuty(revIndxs[i], FIRE_REV_IDLE_COEF);
-            }
-
-            if(fireStates[i] == Ready && millis() >= revStartMs[i]){
-                if((fire || burstCount > 0) && nextFire == i){
-
-                    fireStates[i] = SolOn;
-                    digitalWrite(fireSolenoidPins[i], HIGH);
-                    //digitalWrite(LED_PIN, LOW);
-
-                    if(burstCount > 0){
-                        burstCount--;
-                    }
-
-                    paddleMovementMs = millis();
-                    fireTimer[i] = millis() + FIRE_ON_MS;
-                }
-            }else if(fireStates[i] == SolOn){
-                if(millis() > fireTimer[i]){
-                    fireStates[i] = SolOff;
-                    digitalWrite(fireSolenoidPins[i], LOW);
-                    //digitalWrite(LED_PIN, HIGH);
-                    fireTimer[i] = millis() + FIRE_OFF_MS + ((burstCount > 0) ? FIRE_DELAY_BURST : fireDelays[fireRate]);
-                }
-            }else if(fireStates[i] == SolOff){
-                if(millis() > fireTimer[i]){
-                    fireStates[i] = Ready;
-                    BBBalance[i] -= 1;
-
-                    if(nextFire == i){
-                        nextFire++;
-                        if(nextFire == WINGS){
-                            nextFire = 0;
-                        }
-                    }
-                }
-            }
-
-
-
-        }else{
-            revStartDebounce[i] = false;
-            BBBalance[i] = 0;
-            burstCount = 0;
-            WritePWMDuty(revIndxs[i], 0.0f);
-            digitalWrite(fireSolenoidPins[i], LOW);
+    StepFire(wings);
+}
+
+// Feeding, indexed by FeedState
+
+void SetFeedState(uint8_t i, FeedState s){
+    wings.feedStates[i] = s;
+    TelemLogEvent(EvFeedState, i | (s << 8));
+}
+
+// The handlers only move the state along, the motors are set once per pass by FeedMotors()
+
+template<uint8_t N> void FeedNominal(WingArray<N> &w, uint8_t i){
+    FeedState verdict = JamDetectVerdict(i);
+    if(verdict == Clump){
+        SetFeedState(i, Clump);
+        w.feedTimer[i] = millis() + CLUMP_CLEAR_VIBRATE_MS;
+
+    }else if(verdict == Jam){
+        SetFeedState(i, Jam);
+        w.feedTimer[i] = millis();
+    }
+}
+
+template<uint8_t N> void FeedClump(WingArray<N> &w, uint8_t i){
+    if(millis() > w.feedTimer[i]){
+        SetFeedState(i, Cooldown);
+        w.feedTimer[i] = millis() + CLUMP_CLEAR_COOLDOWN_MS;
+    }
+}
+
+template<uint8_t N> void FeedJam(WingArray<N> &w, uint8_t i){
+    if(millis() > (w.feedTimer[i] + JAM_CLEAR_VIBRATE_MS)){
+        SetFeedState(i, Cooldown);
+        w.feedTimer[i] = millis() + JAM_CLEAR_COOLDOWN_MS;
+    }
+}
+
+template<uint8_t N> void FeedCooldown(WingArray<N> &w, uint8_t i){
+    if(millis() > w.feedTimer[i]){
+        SetFeedState(i, Nominal);
+        w.BBBalance[i] = 0;
+        JamDetectReset(i);
+    }
+}
+
+// The feeder and its aux motor are shared by every wing, so their duty comes from all the wings'
+// states together and is written once. A jam in its back phase stops the feeder (it can't run
+// backwards off a PCA9685 channel), then a jam pushes through at full duty, then a clump runs it at
+// CLUMP_CLEAR_FEED_DUTY, otherwise it's FeedControl's duty. The aux motor vibrates while any wing
+// is clearing or cooling down.
+template<uint8_t N> void FeedMotors(WingArray<N> &w){
+    bool backing = false, pushing = false, clumped = false;
+    bool aux = nominalFeedDuty > 0.0f;
+
+    for(uint8_t i = 0; i < N; i++){
+        if(w.feedStates[i] == Jam){
+            if(millis() > w.feedTimer[i] + JAM_CLEAR_BACK_MS)
+                pushing = true;
+            else
+                backing = true;
+        }else if(w.feedStates[i] == Clump){
+            clumped = true;
         }
+        aux |= w.feedStates[i] != Nominal;
     }
+
+    MotorSetDuty(MOTOR_FEEDER, backing ? 0.0f : pushing ? 1.0f : clumped ? CLUMP_CLEAR_FEED_DUTY : nominalFeedDuty);
+    MotorSetDuty(MOTOR_FEEDER_AUX, aux ? 1.0f : 0.0f);
 }
 
-void FeedLoop(){
-    for(uint8_t i = 0; i < WINGS; i++){
-        bool paddle = digitalRead(feederSensePins[i]);
-        if(paddle != lastPaddleState[i]){
-            if(millis() - lastPaddleDebounceMillis[i] > PADDLE_DETECT_DEBOUNCE_MS){
-                lastPaddleState[i] = paddle;
-
-                if(paddle){
-                    lastPaddleDebounceMillis[i] = millis();
-                    BBBalance[i] += 1;
-                    paddleMovementMs = millis();
-                }
-            }
+template<uint8_t N> constexpr WingStep<N> feedSteps[FEED_STATE_COUNT] = {FeedNominal<N>, FeedJam<N>, FeedClump<N>, FeedCooldown<N>};
+static_assert(Nominal == 0 && Jam == 1 && Clump == 2 && Cooldown == 3, "feedSteps is in FeedState order");
+
+template<uint8_t N> void StepFeed(WingArray<N> &w, const uint32_t (&paddles)[N], const PowerSnapshot &power){
+    for(uint8_t i = 0; i < N; i++){
+        if(paddles[i] != w.lastPaddleCount[i]){
+            w.BBBalance[i] += paddles[i] - w.lastPaddleCount[i];
+            w.lastPaddleCount[i] = paddles[i];
+            paddleMovementMs = millis();
         }
 
-        if(feedStates[i] == Nominal){
-            if(doRev && (millis() - paddleMovementMs < PADDLE_IDLE_STOP_MS) ){
-                WritePWMDuty(FEEDER_MOTOR_INDX, 0.7f);
-                WritePWMDuty(FEEDER_AUX_INDX, 1.0f);
-            }else{
-                WritePWMDuty(FEEDER_MOTOR_INDX, 0.0f);
-                WritePWMDuty(FEEDER_AUX_INDX, 0.0f);
-            }
-                
-                /*
-            if(BBBalance[i] > BBBALANCE_CLUMP_THRESHOLD){
-                feedStates[i] = Clump;
-                WritePWMDuty(FEEDER_AUX_INDX, 1.0f);
-                feedTimer[i] = millis() + CLUMP_CLEAR_VIBRATE_MS;
-
-            }else if(BBBalance[i] < -BBBALANCE_JAM_THRESHOLD){
-                Serial.println("jam time");
-                feedStates[i] = Jam;
-                WritePWMDuty(FEEDER_AUX_INDX, 1.0f);
-                //FeedMotorsSpeed(-255);
-                feedTimer[i] = millis();
-            }
-            */
-
-        }else if(feedStates[i] == Clump){
-            WritePWMDuty(FEEDER_MOTOR_INDX, 0.8f);
-            if(millis() > feedTimer[i]){
-                WritePWMDuty(FEEDER_AUX_INDX, 0.0f);
-                feedStates[i] = Cooldown;
-                feedTimer[i] = millis() + CLUMP_CLEAR_COOLDOWN_MS;
-            }
-
-        }else if(feedStates[i] == Jam){
-            Serial.println("we jammin");
-            if(millis() > (feedTimer[i] + JAM_CLEAR_BACK_MS)){
-                WritePWMDuty(FEEDER_MOTOR_INDX, 1.0f);
-                Serial.println("go back no more");
-            }
-
-            if(millis() > (feedTimer[i] + JAM_CLEAR_VIBRATE_MS)){
-                WritePWMDuty(FEEDER_AUX_INDX, 0.0f);
-                feedStates[i] = Cooldown;
-                feedTimer[i] = millis() + JAM_CLEAR_COOLDOWN_MS;
-            }
-
-        }else if(feedStates[i] == Cooldown){
-            WritePWMDuty(FEEDER_AUX_INDX, 1.0f);
-            if(millis() > feedTimer[i]){
-                feedStates[i] = Nominal;
-                BBBalance[i] = 0;
-            }
+        JamDetectUpdate(i, paddles[i], w.fireStates[i], power);
+        feedSteps<N>[w.feedStates[i]](w, i);
+    }
+    FeedMotors(w);
+}
+
+void FeedLoop(){
+    PowerSnapshot power;
+    PowerRead(power);
+
+    uint32_t paddles[WINGS]; // Read once, the bounce limiter in ReadPaddleCount() keeps state
+    for(uint8_t i = 0; i < WINGS; i++)
+        paddles[i] = ReadPaddleCount(i);
+
+    nominalFeedDuty = 0.0f;
+    if(doRev && (millis() - paddleMovementMs < PADDLE_IDLE_STOP_MS)){
+        uint32_t total = 0;
+        for(uint8_t i = 0; i < WINGS; i++)
+            total += paddles[i];
+
+        uint32_t cycleUs = (FIRE_ON_MS + FIRE_OFF_MS + (burstCount > 0 ? FIRE_DELAY_BURST : fireDelayMs)) * 1000UL;
+        nominalFeedDuty = FeedControlUpdate(FeedTargetHz(fire || burstCount > 0, cycleUs), total);
+    }else{
+        FeedControlReset();
+    }
+
+    StepFeed(wings, paddles, power);
+}
+
+
+void ApplyControlCommands(){
+    ControlCmd cmd;
+
+    while(controlCmds.Pop(cmd)){
+        if(cmd.type == CmdAim){
+            tracking = false;
+            pitch = cmd.a;
+            yaw = cmd.b;
+        }else if(cmd.type == CmdTrack){
+            if(!tracking)
+                aimFilter.valid = false;
+            tracking = true;
+
+            uint32_t rxUs = cmd.lat.rxUs ? cmd.lat.rxUs : cmd.us; // The datagram, not SendControl() after the drain
+            aimQueueMs = aimQueueMs * 0.9f + (micros() - rxUs) / 10000.0f;
+            AimFilterUpdate(aimFilter, cmd.a, cmd.b, rxUs);
+        }else if(cmd.type == CmdAimLatency){
+            aimHostLatencyMs = cmd.n;
+        }else if(cmd.type == CmdFire){
+            fire = cmd.n;
+        }else if(cmd.type == CmdRev){
+            doRev = cmd.n;
+        }else if(cmd.type == CmdBurst){
+            burstCount = cmd.n;
+        }else if(cmd.type == CmdWings){
+            for(uint8_t i = 0; i < WINGS; i++)
+                wings.targetWingStates[i] = (WingState) cmd.n;
+        }else if(cmd.type == CmdSafety){
+            safety = cmd.n;
+        }else if(cmd.type == CmdFireDelay){
+            fireDelayMs = cmd.n;
+        }else if(cmd.type == CmdVolley){
+            SetVolley((VolleyPattern) cmd.n, cmd.a);
+        }else if(cmd.type == CmdServoCal){
+            ServoCalCommand((ServoCalAction) cmd.n, cmd.a);
         }
+        LatencyApplied(cmd);
     }
 }
 
+void PublishControlState(){
+    ControlState st;
+    st.timeMs = millis();
+    st.pitch = pitch;
+    st.yaw = yaw;
+    st.tracking = tracking;
+    st.aimLeadMs = aimHostLatencyMs + aimQueueMs;
+    st.fire = fire;
+    st.doRev = doRev;
+    st.safety = safety;
+    st.burstCount = burstCount;
 
-void setup() {
-    Serial.begin(115200);
-    Serial.setTimeout(200);
+    for(uint8_t i = 0; i < WINGS; i++){
+        st.wingStates[i] = wings.wingStates[i];
+        st.targetWingStates[i] = wings.targetWingStates[i];
+        st.fireStates[i] = wings.fireStates[i];
+        st.feedStates[i] = wings.feedStates[i];
+        st.BBBalance[i] = wings.BBBalance[i];
+        st.openSW[i] = digitalRead(openSWPins[i]);
+        st.closedSW[i] = digitalRead(closedSWPins[i]);
+    }
 
-    InitPins();
-    InitPWM();
-    InitNeopixel();
-    
+    // A full queue drops this one, the newest, not the oldest. The app side drains the lot on its next
+    // pass, so it sees a snapshot up to CONTROL_STATE_QUEUE_LEN publishes old until the next one lands.
+    controlStates.Push(st);
+}
 
-    WiFi.softAP("Turret", "idonthateyou");
+void LogStatus(){
+    TelemStatusRec st;
+    PowerSnapshot power;
+    PowerRead(power);
 
-    for(uint8_t i = 0; i < WINGS; i++){ 
-        targetWingStates[i] = Closed;
-        wingStates[i] = Unknown;
+    st.timeMs = millis();
+    st.flags = (fire ? TELEM_FLAG_FIRE : 0) | (doRev ? TELEM_FLAG_REV : 0) | (safety ? TELEM_FLAG_SAFETY : 0) |
+               (tracking ? TELEM_FLAG_TRACKING : 0);
+    st.pitchCd = pitch * 100.0f;
+    st.yawCd = yaw * 100.0f;
+    st.burstCount = burstCount;
 
-        if(digitalRead(closedSWPins[i]) && digitalRead(openSWPins[i])){
-        wingStates[i] = Closed;
-        }
+    for(uint8_t i = 0; i < WINGS; i++){
+        st.wing[i] = wings.wingStates[i] | (wings.targetWingStates[i] << 4);
+        st.fireFeed[i] = wings.fireStates[i] | (wings.feedStates[i] << 4);
+        st.BBBalance[i] = constrain(wings.BBBalance[i], -128, 127);
+        st.currentMA[i] = constrain(power.wing[i].currentMA, -32768.0f, 32767.0f);
+        st.busMV[i] = power.wing[i].busV * 1000.0f;
+
+        if(digitalRead(openSWPins[i]))
+            st.flags |= TELEM_FLAG_OPEN_SW(i);
+        if(digitalRead(closedSWPins[i]))
+            st.flags |= TELEM_FLAG_CLOSED_SW(i);
     }
-    InitServer();
-    InitAudio();
 
-    //delay(2500); //Prevents boot from being high when opening serial
-    Serial.println(WiFi.softAPIP());
+    TelemPush(TelemStatus, &st, sizeof(st));
 }
 
-void loop() {
+void ControlTick(){
+    uint32_t cycles = ProfStart();
+
+    ApplyControlCommands();
+    FireEngineLoop();
+    SchedulerRun(esp_timer_get_time());
+    LatencyLoop();
+    FlushPWM();
+
+    ProfEnd(ProfTick, cycles);
+}
+
+void ControlWake(uint32_t bits){
+    if(bits & SCHED_NOTIFY_ENDSTOP)
+        HandleEndstops();
+
+    if(bits & SCHED_NOTIFY_TICK)
+        ControlTick();
+}
 
+void ControlTask(void *){
+    InitScheduler();
+    InitEndstops();
+
+    for(;;)
+        ControlWake(SchedulerWait());
+}
+
+void AppLoop(){
+    PollControlState();
+
+    uint32_t cycles = ProfStart();
     ServerLoop();
+    ProfEnd(ProfServer, cycles);
 
     if(Serial.available()){
         char r = Serial.read();
+        float p = ctlState.pitch;
+        float y = ctlState.yaw;
 
         if(r == 'i'){
-            pitch += 1.0f;
+            p += 1.0f;
         }else if(r == 'k'){
-            pitch -= 1.0f;
+            p -= 1.0f;
         }else if(r == 'j'){
-            yaw += 1.0f;
+            y += 1.0f;
         }else if(r == 'l'){
-            yaw -= 1.0f;
+            y -= 1.0f;
         }else if(r == 'y'){
-            doRev = true;
-            fire = true;
+            SendControl(CmdRev, true);
+            SendControl(CmdFire, true);
         }else if(r == 'h'){
-            doRev = false;
-            fire = false;
+            SendControl(CmdRev, false);
+            SendControl(CmdFire, false);
         }else if(r == 't'){
-            doRev = true;
+            SendControl(CmdRev, true);
 
         }else if (r == 'u'){
-            targetWingStates[0] = Closed;
-            targetWingStates[1] = Closed;
+            SetWings(Closed);
         }else if (r == 'o'){
-            targetWingStates[0] = Open;
-            targetWingStates[1] = Open;
+            SetWings(Open);
+        }else if (r == 'c'){
+            SchedulerPrintStats();
+            PrintPWMStats();
+            FireEnginePrintStats();
+            PowerPrintStats();
+            JamDetectPrintStats();
+            MotorStartPrintStats();
+            ServerPrintStats();
+            LatencyPrintStats();
+        }else if (r == 'C'){
+            SchedulerResetStats();
+            FireEngineResetStats();
+            PowerResetStats();
+            MotorStartResetStats();
+            LatencyResetStats();
+        }else if (r == 'v'){
+            SendControl(CmdServoCal, CalNextServo);
+        }else if (r == 'n' || r == 'b'){
+            SendControl(CmdServoCal, CalKnot, r == 'n' ? 1 : -1);
+        }else if (r == '[' || r == ']'){
+            SendControl(CmdServoCal, CalJog, r == ']' ? 1 : -1);
+        }else if (r == '{' || r == '}'){
+            SendControl(CmdServoCal, CalJog, r == '}' ? 10 : -10);
+        }else if (r == 'V'){
+            SendControl(CmdServoCal, CalSave);
+        }else if (r == 'X'){
+            SendControl(CmdServoCal, CalDefault);
+        }else if (r == 'p'){
+            ProfPrint();
+        }else if (r == 'P'){
+            ProfReset();
         }
 
-        pitch = constrain(pitch, PITCH_MIN_ANGLE, PITCH_MAX_ANGLE); 
-        yaw = constrain(yaw, -YAW_MAX_ANGLE, YAW_MAX_ANGLE); //using the negative of min as max is intentional
+        p = constrain(p, PITCH_MIN_ANGLE, PITCH_MAX_ANGLE); 
+        y = constrain(y, -YAW_MAX_ANGLE, YAW_MAX_ANGLE); //using the negative of min as max is intentional
+
+        if(p != ctlState.pitch || y != ctlState.yaw){
+            SendControl(CmdAim, 0, p, y);
+            ctlState.pitch = p; // So repeated key presses stack before the next snapshot arrives
+            ctlState.yaw = y;
+        }
+    }
 
-        pitches[0] = pitch;
-        pitches[1] = pitch;
+    static uint64_t ledMillis = 0;
+    if(millis() - ledMillis >= 1000 / LED_LOOP_HZ){
+        cycles = ProfStart();
+        NeoPixelLoop();
+        ProfEnd(ProfLeds, cycles);
+        ledMillis = millis();
+    }
+}
 
-        yaws[0] = yaw;
-        yaws[1] = yaw;
+void AppTask(void *){
+    for(;;){
+        AppLoop();
+        vTaskDelay(1);
     }
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.setTimeout(200);
+
+    InitPins();
+    InitPWM();
+    InitServoCal();
+    InitPowerSampler();
+    InitFireEngine();
+    InitNeopixel();
+    
 
-    WingLoop();
-    FireLoop();
-    FeedLoop();
-    NeoPixelLoop();
-
-    static uint64_t sendMillis = 0;
-    if(millis() - sendMillis > 100){
-        //Serial.println("RIGHT: P: " + String(pitch) + " Y: " + String(yaw) + " S: " + String(wingStates[0]) + " T: " + String(targetWingStates[0]) + " O: " + String(digitalRead(openSWPins[0])) + " C: " + String(digitalRead(closedSWPins[0])));
-        Serial.println("LEFT: P: " + String(pitch) + " Y: " + String(yaw) + " S: " + String(wingStates[1]) + " T: " + String(targetWingStates[1]) + " O: " + String(digitalRead(openSWPins[1])) + " C: " + String(digitalRead(closedSWPins[1])));
-        
-        sendMillis = millis();
-    } 
+    WiFi.softAP("Turret", "idonthateyou");
+
+    for(uint8_t i = 0; i < WINGS; i++){ 
+        InitProfile(wings.pitchProfiles[i], pitchOffts[i], pitchMaxVel[i], pitchMaxAcc[i]);
+        InitProfile(wings.yawProfiles[i], yawOffts[i], yawMaxVel[i], yawMaxAcc[i]);
+
+        wings.targetWingStates[i] = Closed;
+        wings.wingStates[i] = Unknown;
+
+        if(digitalRead(closedSWPins[i]) && digitalRead(openSWPins[i])){
+        wings.wingStates[i] = Closed;
+        }
+    }
+    InitServer();
+    InitAudio();
+
+    SchedulerAdd("fire", FireLoop, FIRE_LOOP_HZ, ProfFire);
+    SchedulerAdd("wing", WingLoop, WING_LOOP_HZ, ProfWing);
+    SchedulerAdd("feed", FeedLoop, FEED_LOOP_HZ, ProfFeed);
+    SchedulerAdd("rev", RevDetectLoop, REV_DETECT_HZ, ProfRev);
+    SchedulerAdd("motors", MotorStartLoop, MOTOR_START_HZ, ProfMotors);
+    SchedulerAdd("state", PublishControlState, STATE_PUBLISH_HZ, ProfState);
+    SchedulerAdd("status", LogStatus, TELEM_STATUS_HZ, ProfStatus);
+
+    xTaskCreatePinnedToCore(ControlTask, "Control", 4096, NULL, CONTROL_TASK_PRIO, NULL, CONTROL_CORE);
+    InitTelemetry();
+    xTaskCreatePinnedToCore(AppTask, "App", 8192, NULL, APP_TASK_PRIO, NULL, APP_CORE);
+
+    //delay(2500); //Prevents boot from being high when opening serial
+    Serial.println(WiFi.softAPIP());
+}
+
+void loop() {
+    vTaskDelete(NULL); // All the work happens in ControlTask and AppTask
 }
\ No newline at end of file
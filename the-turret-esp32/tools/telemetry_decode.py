@@ -0,0 +1,164 @@
+"""Decode the turret's binary telemetry (see src/Telemetry.h).
+
+    python telemetry_decode.py --serial /dev/ttyUSB0
+    python telemetry_decode.py --udp 192.168.4.1      (asks the turret to stream to us)
+    python telemetry_decode.py --file capture.bin
+
+Frames are 0xA5 type len payload crc8. Bytes that aren't part of a valid frame are printed as text.
+"""
+import argparse
+import socket
+import struct
+import sys
+
+TELEM_SYNC = 0xA5
+TELEM_UDP_PORT = 4211
+TURRET_UDP_PORT = 21
+WINGS = 2
+
+WING_STATES = ["Unknown", "Open", "Closing", "ClosingSlow", "Closed", "Opening", "Zeroing"]
+FIRE_STATES = ["Ready", "SolOn", "SolOff"]
+FEED_STATES = ["Nominal", "Jam", "Clump", "Cooldown"]
+FIRE_RATES = ["Fast", "Medium", "Slow"]
+FIRE_MODES = ["Auto", "Burst", "Single"]
+VOLLEY_PATTERNS = ["Alternate", "Simultaneous", "Staggered"]
+
+EVENTS = {
+    1: "WingOpen",
+    2: "WingClosed",
+    3: "FeedState",
+    4: "FireRate",
+    5: "FireMode",
+    6: "Safety",
+    7: "ControlQueueFull",
+    8: "TelemDropped",
+    9: "RevReady",
+    10: "RevTimeout",
+    11: "Volley",
+}
+
+# Must match TelemStatusRec
+STATUS = struct.Struct("<I%dB%dBHhh%dbH%dh%dH" % (WINGS, WINGS, WINGS, WINGS, WINGS))
+EVENT = struct.Struct("<IBi")
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def name(table, i):
+    return table[i] if i < len(table) else str(i)
+
+
+def decode_status(p):
+    f = STATUS.unpack(p)
+    t, wing, fire_feed = f[0], f[1:1 + WINGS], f[1 + WINGS:1 + 2 * WINGS]
+    flags, pitch, yaw = f[1 + 2 * WINGS:4 + 2 * WINGS]
+    rest = f[4 + 2 * WINGS:]
+    bb, burst, cur, bus = rest[:WINGS], rest[WINGS], rest[WINGS + 1:2 * WINGS + 1], rest[2 * WINGS + 1:]
+
+    out = "%8d STATUS P:%6.2f Y:%6.2f" % (t, pitch / 100.0, yaw / 100.0)
+    out += " fire:%d rev:%d safe:%d track:%d burst:%d" % (flags & 1, flags >> 1 & 1, flags >> 2 & 1, flags >> 3 & 1, burst)
+    for i in range(WINGS):
+        out += " | W%d %s->%s %s %s O:%d C:%d BB:%d %dmA %.2fV" % (
+            i, name(WING_STATES, wing[i] & 0xF), name(WING_STATES, wing[i] >> 4),
+            name(FIRE_STATES, fire_feed[i] & 0xF), name(FEED_STATES, fire_feed[i] >> 4),
+            flags >> (4 + 2 * i) & 1, flags >> (5 + 2 * i) & 1, bb[i], cur[i], bus[i] / 1000.0)
+    return out
+
+
+def decode_event(p):
+    t, code, value = EVENT.unpack(p)
+    ev = EVENTS.get(code, "Event%d" % code)
+    if code == 3:
+        value = "wing %d %s" % (value & 0xFF, name(FEED_STATES, value >> 8))
+    elif code == 9:
+        value = "wing %d %dms" % (value & 0xFF, value >> 8)
+    elif code == 11:
+        value = "%s offset %dms" % (name(VOLLEY_PATTERNS, value & 0xFF), value >> 8)
+    elif code == 4:
+        value = name(FIRE_RATES, value)
+    elif code == 5:
+        value = name(FIRE_MODES, value)
+    return "%8d EVENT %s %s" % (t, ev, value)
+
+
+def decode_text(p):
+    t, = struct.unpack_from("<I", p)
+    return "%8d TEXT %s" % (t, p[4:].decode(errors="replace"))
+
+
+DECODERS = {1: decode_status, 2: decode_event, 3: decode_text}
+
+
+class Decoder:
+    def __init__(self, out):
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.out = out
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            if self.buf[0] != TELEM_SYNC:
+                self.plain(self.buf.pop(0))
+                continue
+            if len(self.buf) < 3 or len(self.buf) < self.buf[2] + 4:
+                return
+            n = self.buf[2]
+            frame = self.buf[:n + 4]
+            if crc8(frame[1:n + 3]) != frame[n + 3] or frame[1] not in DECODERS:
+                self.plain(self.buf.pop(0))
+                continue
+            del self.buf[:n + 4]
+            try:
+                self.out(DECODERS[frame[1]](bytes(frame[3:n + 3])))
+            except struct.error:
+                self.out("bad %d byte payload for type %d" % (n, frame[1]))
+
+    def plain(self, b):
+        if b == ord("\n"):
+            self.out(self.text.decode(errors="replace").rstrip("\r"))
+            self.text.clear()
+        else:
+            self.text.append(b)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    src = ap.add_mutually_exclusive_group(required=True)
+    src.add_argument("--serial", help="serial port the turret is on")
+    src.add_argument("--udp", metavar="TURRET_IP", help="subscribe over WiFi")
+    src.add_argument("--file", help="raw capture")
+    ap.add_argument("--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    dec = Decoder(print)
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            dec.feed(f.read())
+    elif args.serial:
+        import serial
+        with serial.Serial(args.serial, args.baud, timeout=0.1) as port:
+            while True:
+                dec.feed(port.read(256))
+    else:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind(("", TELEM_UDP_PORT))
+        sock.sendto(b"telem", (args.udp, TURRET_UDP_PORT))
+        while True:
+            data, _ = sock.recvfrom(2048)
+            dec.feed(data)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        sys.exit(0)